@@ -0,0 +1,83 @@
+-- bigfile.lua
+--
+-- One shared big-file detector. Size is checked on BufReadPre (before the
+-- read), line count on BufReadPost, and a hit sets `vim.b.bigfile`.
+-- treesitter, gitsigns, ibl, mini.map, scrollview and the lsp all ask
+-- `is_big(buf)` instead of keeping their own cutoffs.
+--
+-- Thresholds: vim.g.neo_mittens_bigfile_size (bytes, default 2MB) and
+-- vim.g.neo_mittens_bigfile_lines (default 40000).
+
+local M = {}
+
+M.max_size = vim.g.neo_mittens_bigfile_size or 2 * 1024 * 1024
+M.max_lines = vim.g.neo_mittens_bigfile_lines or 40000
+
+function M.is_big(buf)
+  if buf == nil or buf == 0 then buf = vim.api.nvim_get_current_buf() end
+  return vim.api.nvim_buf_is_valid(buf) and vim.b[buf].bigfile == true
+end
+
+local function mark(buf)
+  vim.b[buf].bigfile = true
+  vim.b[buf].minimap_disable = true
+  vim.bo[buf].swapfile = false
+  vim.bo[buf].undofile = false
+end
+
+-- window and syntax stuff only makes sense once the buffer is displayed
+local function strip(buf)
+  for _, win in ipairs(vim.fn.win_findbuf(buf)) do
+    vim.wo[win].foldmethod = "manual"
+    vim.wo[win].foldenable = false
+  end
+  -- filetype detection runs after us on BufReadPost and turns syntax back on
+  vim.schedule(function()
+    if vim.api.nvim_buf_is_valid(buf) then vim.bo[buf].syntax = "OFF" end
+  end)
+end
+
+-- scrollview has its own knobs, keep them in line with ours
+vim.g.scrollview_line_limit = M.max_lines
+vim.g.scrollview_byte_limit = M.max_size
+
+local group = vim.api.nvim_create_augroup("NeoMittensBigfile", { clear = true })
+
+vim.api.nvim_create_autocmd("BufReadPre", {
+  group = group,
+  callback = function(args)
+    local stat = args.file ~= "" and vim.loop.fs_stat(args.file)
+    if stat and stat.size > M.max_size then mark(args.buf) end
+  end,
+})
+
+vim.api.nvim_create_autocmd("BufReadPost", {
+  group = group,
+  callback = function(args)
+    if not M.is_big(args.buf) and vim.api.nvim_buf_line_count(args.buf) > M.max_lines then
+      mark(args.buf)
+    end
+    if M.is_big(args.buf) then strip(args.buf) end
+  end,
+})
+
+vim.api.nvim_create_autocmd("BufWinEnter", {
+  group = group,
+  callback = function(args)
+    if not M.is_big(args.buf) then return end
+    vim.wo.foldmethod = "manual"
+    vim.wo.foldenable = false
+  end,
+})
+
+vim.api.nvim_create_autocmd("LspAttach", {
+  group = group,
+  callback = function(args)
+    if not M.is_big(args.buf) then return end
+    vim.schedule(function()
+      vim.lsp.buf_detach_client(args.buf, args.data.client_id)
+    end)
+  end,
+})
+
+return M
@@ -0,0 +1,276 @@
+-- blame.lua
+--
+-- Cached git blame, so <leader>hb and the current line blame don't run a
+-- fresh `git blame` over deep history every time.
+--
+-- Blame is taken against HEAD and cached by the blob SHA of the file at
+-- HEAD. Every buffer showing the same file shares it, and it is persisted
+-- under stdpath("cache")/neo-mittens/blame, so reopening the file (or
+-- restarting) costs nothing. Buffer lines are mapped onto HEAD lines by
+-- diffing the buffer against the HEAD blob; lines inside a hunk (staged or
+-- not) are "Not committed yet".
+--
+-- Only the visible range (plus a margin) gets blamed by default, set
+-- vim.g.neo_mittens_blame_visible_only = false to blame whole files.
+
+local util = require("neo-mittens.util")
+
+local M = {}
+
+local cache_dir = vim.fn.stdpath("cache") .. "/neo-mittens/blame"
+local ns = vim.api.nvim_create_namespace("neo_mittens_blame")
+local margin = 50
+
+local blobs = {}   -- blob sha -> { lines = { ["lnum"] = sha }, commits = { sha = info } }
+local buffers = {} -- bufnr -> { root, rel, head, blob }
+
+M.enabled = false -- current line blame
+
+local function load_blob(blob)
+  if blobs[blob] then return blobs[blob] end
+  local entry = { lines = {}, commits = {} }
+  local f = io.open(cache_dir .. "/" .. blob .. ".json", "r")
+  if f then
+    local ok, decoded = pcall(vim.json.decode, f:read("*a"))
+    f:close()
+    if ok and type(decoded) == "table" then entry = decoded end
+  end
+  blobs[blob] = entry
+  return entry
+end
+
+local function save_blob(blob)
+  vim.fn.mkdir(cache_dir, "p")
+  vim.fn.writefile({ vim.json.encode(blobs[blob]) }, cache_dir .. "/" .. blob .. ".json")
+end
+
+local texts = {}   -- blob sha -> { text, count }, the HEAD version to diff against
+
+-- Resolves (and remembers) which HEAD blob the buffer is, and its content
+local function resolve(buf, cb)
+  local status = vim.b[buf].gitsigns_status_dict
+  local file = vim.api.nvim_buf_get_name(buf)
+  if not status or not status.root or file == "" then return cb(nil) end
+  local state = buffers[buf]
+  if state and state.blob then return cb(state) end
+
+  local rel = file:sub(#status.root + 2)
+  util.job({ "git", "rev-parse", "HEAD", "HEAD:" .. rel }, { cwd = status.root }, function(code, out)
+    if code ~= 0 or #out < 2 then return cb(nil) end
+    local new = { root = status.root, rel = rel, head = out[1], blob = out[2] }
+    local function done()
+      buffers[buf] = new
+      cb(new)
+    end
+    if texts[new.blob] then return done() end
+    util.job({ "git", "cat-file", "blob", new.blob }, { cwd = status.root }, function(code2, lines)
+      if code2 ~= 0 then return cb(nil) end
+      texts[new.blob] = { text = #lines > 0 and table.concat(lines, "\n") .. "\n" or "", count = #lines }
+      done()
+    end)
+  end)
+end
+
+-- Buffer vs HEAD hunks, { start_head, count_head, start_buf, count_buf }.
+-- Diffed here rather than taken from gitsigns, which diffs against the
+-- index, so staged lines would land on the wrong HEAD lines.
+local function hunks_of(state, buf)
+  local tick = vim.api.nvim_buf_get_changedtick(buf)
+  if state.tick ~= tick then
+    local lines = vim.api.nvim_buf_get_lines(buf, 0, -1, false)
+    local text = #lines > 0 and table.concat(lines, "\n") .. "\n" or ""
+    state.hunks = vim.diff(texts[state.blob].text, text, { result_type = "indices" }) or {}
+    state.tick = tick
+  end
+  return state.hunks
+end
+
+-- buffer line -> HEAD line, nil when the line is a local change (staged or not)
+local function to_head(state, buf, lnum)
+  local offset = 0
+  for _, h in ipairs(hunks_of(state, buf)) do
+    local removed, start, added = h[2], h[3], h[4]
+    if added > 0 and lnum >= start and lnum < start + added then return nil end
+    if (added > 0 and start + added - 1 < lnum) or (added == 0 and start < lnum) then
+      offset = offset + removed - added
+    end
+  end
+  return lnum + offset
+end
+
+local function parse_porcelain(out, entry)
+  local sha
+  for _, line in ipairs(out) do
+    local s, final = line:match("^(%x+) %d+ (%d+)")
+    if s and #s == 40 then
+      sha = s
+      entry.lines[final] = sha
+      entry.commits[sha] = entry.commits[sha] or {}
+    elseif sha and line:sub(1, 1) ~= "\t" then
+      local key, value = line:match("^(%S+) (.*)$")
+      local info = entry.commits[sha]
+      if key == "author" or key == "author-time" or key == "summary" then
+        info[key] = value
+      end
+    end
+  end
+end
+
+-- HEAD line ranges in [first, last] that aren't cached yet
+local function missing_ranges(entry, first, last)
+  local ranges, start = {}, nil
+  for l = first, last do
+    if not entry.lines[tostring(l)] then
+      start = start or l
+    elseif start then
+      table.insert(ranges, { start, l - 1 })
+      start = nil
+    end
+  end
+  if start then table.insert(ranges, { start, last }) end
+  return ranges
+end
+
+local pending = {} -- blob sha -> callbacks waiting on the running blame
+
+-- Makes sure HEAD lines [first, last] of the buffer's blob are blamed
+local function ensure(state, first, last, cb)
+  local entry = load_blob(state.blob)
+  local ranges = missing_ranges(entry, first, last)
+  if #ranges == 0 then return cb(entry) end
+  if pending[state.blob] then
+    -- try again once that one is in, it may well have covered these lines
+    table.insert(pending[state.blob], { first, last, cb })
+    return
+  end
+
+  local cmd = { "git", "blame", "--porcelain" }
+  for _, r in ipairs(ranges) do table.insert(cmd, ("-L%d,%d"):format(r[1], r[2])) end
+  vim.list_extend(cmd, { state.head, "--", state.rel })
+
+  pending[state.blob] = {}
+  util.job(cmd, { cwd = state.root }, function(code, out)
+    local waiting = pending[state.blob]
+    pending[state.blob] = nil
+    if code == 0 then
+      parse_porcelain(out, entry)
+      save_blob(state.blob)
+    end
+    cb(entry)
+    -- a failed blame would just fail again, hand them what there is
+    for _, w in ipairs(waiting) do
+      if code == 0 then ensure(state, w[1], w[2], w[3]) else w[3](entry) end
+    end
+  end)
+end
+
+-- cb(info) for buffer line lnum, info = { sha, author, author-time, summary }
+-- or { uncommitted = true }. nil when the file isn't tracked.
+function M.get(buf, lnum, cb)
+  resolve(buf, function(state)
+    if not state then return cb(nil) end
+    local head_lnum = to_head(state, buf, lnum)
+    if not head_lnum then return cb({ uncommitted = true }) end
+
+    local count = texts[state.blob].count
+    local first, last = 1, count
+    if vim.g.neo_mittens_blame_visible_only ~= false then
+      local win = vim.fn.bufwinid(buf)
+      local top = win ~= -1 and vim.fn.line("w0", win) or lnum
+      local bot = win ~= -1 and vim.fn.line("w$", win) or lnum
+      first = math.max(1, math.min(to_head(state, buf, top) or head_lnum, head_lnum) - margin)
+      last = math.min(count, math.max(to_head(state, buf, bot) or head_lnum, head_lnum) + margin)
+    end
+    if head_lnum > count then return cb(nil) end
+
+    ensure(state, first, last, function(entry)
+      local sha = entry.lines[tostring(head_lnum)]
+      if not sha then return cb(nil) end
+      cb(vim.tbl_extend("force", { sha = sha }, entry.commits[sha] or {}))
+    end)
+  end)
+end
+
+local function format(info)
+  if info.uncommitted then return "Not committed yet" end
+  local time = tonumber(info["author-time"])
+  return ("%s, %s - %s"):format(info.author or "?", time and os.date("%Y-%m-%d", time) or "?", info.summary or "")
+end
+
+local function show_current()
+  local buf = vim.api.nvim_get_current_buf()
+  local lnum = vim.api.nvim_win_get_cursor(0)[1]
+  vim.api.nvim_buf_clear_namespace(buf, ns, 0, -1)
+  M.get(buf, lnum, function(info)
+    if not info or not M.enabled or not vim.api.nvim_buf_is_valid(buf) then return end
+    if vim.api.nvim_get_current_buf() ~= buf or vim.api.nvim_win_get_cursor(0)[1] ~= lnum then return end
+    vim.api.nvim_buf_set_extmark(buf, ns, lnum - 1, 0, {
+      virt_text = { { format(info), "GitSignsCurrentLineBlame" } },
+      virt_text_pos = "eol",
+      priority = 100,
+    })
+  end)
+end
+
+-- <leader>hb
+function M.blame_line()
+  local buf = vim.api.nvim_get_current_buf()
+  M.get(buf, vim.api.nvim_win_get_cursor(0)[1], function(info)
+    if not info then return vim.notify("blame: not tracked") end
+    local lines = { format(info) }
+    if info.sha then table.insert(lines, 1, info.sha:sub(1, 12)) end
+    vim.lsp.util.open_floating_preview(lines, "", { border = "single", focus_id = "neo_mittens_blame" })
+  end)
+end
+
+-- <leader>tb
+function M.toggle()
+  M.enabled = not M.enabled
+  if M.enabled then
+    show_current()
+  else
+    for _, buf in ipairs(vim.api.nvim_list_bufs()) do
+      vim.api.nvim_buf_clear_namespace(buf, ns, 0, -1)
+    end
+  end
+end
+
+local group = vim.api.nvim_create_augroup("NeoMittensBlame", { clear = true })
+
+-- same 100ms settle delay gitsigns' current_line_blame_opts used
+local timer = vim.loop.new_timer()
+vim.api.nvim_create_autocmd({ "CursorMoved", "InsertLeave" }, {
+  group = group,
+  callback = function(args)
+    if not M.enabled then return end
+    vim.api.nvim_buf_clear_namespace(args.buf, ns, 0, -1)
+    timer:stop()
+    timer:start(100, 0, vim.schedule_wrap(show_current))
+  end,
+})
+
+vim.api.nvim_create_autocmd("InsertEnter", {
+  group = group,
+  callback = function(args)
+    timer:stop()
+    vim.api.nvim_buf_clear_namespace(args.buf, ns, 0, -1)
+  end,
+})
+
+-- HEAD may have moved (commit, checkout, rebase), look the blob up again
+vim.api.nvim_create_autocmd({ "FocusGained", "BufEnter", "BufWritePost" }, {
+  group = group,
+  callback = function(args) buffers[args.buf] = nil end,
+})
+
+vim.api.nvim_create_autocmd("BufWipeout", {
+  group = group,
+  callback = function(args) buffers[args.buf] = nil end,
+})
+
+function M.teardown()
+  timer:stop()
+  timer:close()
+end
+
+return M
@@ -0,0 +1,136 @@
+-- clangd.lua
+--
+-- clangd command line tuned for big compile_commands.json projects, so
+-- background indexing is bounded and RSS stays predictable.
+--
+-- The profile is picked per project from .neo-mittens.lua
+--
+--   return { clangd = { profile = "laptop", index_file = "build/clangd.idx" } }
+--
+-- falling back to vim.g.neo_mittens_clangd_profile, then "default". Any key
+-- of a profile can be overridden in the project's clangd table as well.
+--
+-- Shared index: `remote_index = "host:port"` points clangd at a
+-- clangd-index-server for the monorepo (`project_root` defaults to the dir
+-- holding .neo-mittens.lua). A `.clangd` with `Index: External: Server:` is
+-- picked up by clangd itself, we only notice it. Either way local background
+-- indexing is switched off, so clangd only indexes the files you have open.
+-- Needs a clangd built with remote index support (the llvm releases are).
+
+local util = require("neo-mittens.util")
+local project = require("neo-mittens.project")
+
+local M = {}
+
+local cpus = util.cpu_count()
+
+M.profiles = {
+  -- dev box: index with every core, keep PCHs in memory
+  default = {
+    jobs = cpus,
+    background_index = true,
+    pch_storage = "memory",
+    limit_results = 500,
+  },
+  -- laptops and shared boxes: a quarter of the cores, PCHs on disk
+  laptop = {
+    jobs = math.max(1, math.floor(cpus / 4)),
+    background_index = true,
+    background_index_priority = "low",
+    pch_storage = "disk",
+    limit_results = 200,
+  },
+  -- no local background index, rely on a static (index_file) index
+  static = {
+    jobs = math.max(1, math.floor(cpus / 2)),
+    background_index = false,
+    pch_storage = "memory",
+    limit_results = 500,
+  },
+}
+
+-- `Server:` from the nearest .clangd, good enough without a yaml parser
+local function dot_clangd_server(root)
+  local file = vim.fs.find(".clangd", { upward = true, path = root, type = "file" })[1]
+  local f = file and io.open(file, "r")
+  if not f then return nil end
+  local server
+  for line in f:lines() do
+    server = server or line:match("^%s*Server:%s*([^%s#]+)")
+  end
+  f:close()
+  return server
+end
+
+-- Effective settings for a root dir
+function M.settings(root)
+  local conf = project.config(root).clangd or {}
+  local name = conf.profile or vim.g.neo_mittens_clangd_profile or "default"
+  local profile = M.profiles[name]
+  if not profile then
+    vim.notify("neo-mittens: unknown clangd profile " .. name, vim.log.levels.WARN)
+    profile = M.profiles.default
+  end
+  local s = vim.tbl_extend("force", profile, conf)
+
+  s.shared_index = s.remote_index or dot_clangd_server(root)
+  if s.shared_index then
+    -- the index server has everything else already
+    s.background_index = false
+  end
+  return s
+end
+
+local function resolve(root, path)
+  if path:sub(1, 1) == "/" or not root then return path end
+  return root .. "/" .. path
+end
+
+function M.cmd(root)
+  local s = M.settings(root)
+  local cmd = {
+    "clangd",
+    "-j=" .. s.jobs,
+    "--background-index=" .. tostring(s.background_index),
+    "--pch-storage=" .. s.pch_storage,
+    "--malloc-trim",
+    "--limit-results=" .. s.limit_results,
+  }
+  if s.background_index_priority then
+    table.insert(cmd, "--background-index-priority=" .. s.background_index_priority)
+  end
+  if s.remote_index then
+    table.insert(cmd, "--remote-index-address=" .. s.remote_index)
+    table.insert(cmd, "--project-root=" .. (s.project_root or project.root(root) or root))
+  end
+  if s.index_file then
+    table.insert(cmd, "--index-file=" .. resolve(project.root(root) or root, s.index_file))
+  end
+  vim.list_extend(cmd, s.extra_args or {})
+  return cmd
+end
+
+-- Project root: the nearest dir with a compile_commands.json (directly or in
+-- build/) or compile_flags.txt. nil outside a project, so no clangd starts for
+-- a stray header, and every file under one root shares a single client.
+function M.root(fname)
+  local markers = { "compile_commands.json", "build/compile_commands.json", "compile_flags.txt" }
+  for dir in vim.fs.parents(fname) do
+    for _, marker in ipairs(markers) do
+      if vim.loop.fs_stat(dir .. "/" .. marker) then return dir end
+    end
+  end
+end
+
+-- lspconfig options, cmd is worked out once the root is known
+function M.config()
+  return {
+    root_dir = M.root,
+    single_file_support = false,
+    on_new_config = function(new_config, root_dir)
+      new_config.cmd = M.cmd(root_dir)
+    end,
+  }
+end
+
+return M
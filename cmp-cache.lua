@@ -0,0 +1,94 @@
+-- cmp-cache.lua
+--
+-- clangd caps completion at --limit-results and marks those lists
+-- incomplete, so cmp asks again on every keystroke. On heavy template
+-- headers each of those round trips is slow and the popup stutters.
+--
+-- This keeps the last nvim_lsp answer per client and, while you keep
+-- appending to the same word, hands it back to cmp to refilter locally. We
+-- only go back to the server when the cached list has fewer than
+-- vim.g.neo_mittens_cmp_cache_min_hits (10) prefix matches left, the word
+-- starts over, or completion was triggered by hand.
+
+local M = {}
+
+local cache = {}
+
+local function items_of(response)
+  if not response then return nil end
+  return response.items or response
+end
+
+local function hits(items, word, limit)
+  word = word:lower()
+  local n = 0
+  for _, item in ipairs(items) do
+    local text = (item.filterText or item.label or ""):lower()
+    if vim.startswith(text, word) then
+      n = n + 1
+      if n >= limit then break end
+    end
+  end
+  return n
+end
+
+local function lookup(self, params)
+  local ctx = params.context
+  local entry = cache[self.client.id]
+  if not entry or ctx.option.reason == "manual" then return nil end
+  if entry.bufnr ~= ctx.bufnr or entry.row ~= ctx.cursor.row or entry.offset ~= params.offset then
+    return nil
+  end
+  local before = ctx.cursor_before_line
+  if not vim.startswith(before, entry.before) then return nil end
+  -- only plain identifier characters were added since the request
+  if not before:sub(#entry.before + 1):match("^[%w_]*$") then return nil end
+
+  local limit = vim.g.neo_mittens_cmp_cache_min_hits or 10
+  local word = before:sub(params.offset)
+  if entry.complete or hits(entry.items, word, limit) >= limit then
+    return entry.items
+  end
+end
+
+-- the wrapped nvim_lsp source.complete
+local function cached_complete(complete)
+  M.complete = complete
+  return function(self, params, callback)
+    local items = lookup(self, params)
+    if items then
+      -- keep cmp asking us, we decide each time whether the server is needed
+      return callback({ items = items, isIncomplete = true })
+    end
+
+    local ctx = params.context
+    M.complete(self, params, function(response)
+      local got = items_of(response)
+      if got then
+        cache[self.client.id] = {
+          bufnr = ctx.bufnr,
+          row = ctx.cursor.row,
+          offset = params.offset,
+          before = ctx.cursor_before_line,
+          items = got,
+          complete = not response.isIncomplete,
+        }
+      end
+      callback(response)
+    end)
+  end
+end
+
+function M.setup()
+  local ok, source = pcall(require, "cmp_nvim_lsp.source")
+  if not ok or M.complete then return end
+
+  require("neo-mittens.util").wrap(source, "complete", cached_complete)
+
+  vim.api.nvim_create_autocmd({ "InsertLeave", "BufLeave" }, {
+    group = vim.api.nvim_create_augroup("NeoMittensCmpCache", { clear = true }),
+    callback = function() cache = {} end,
+  })
+end
+
+return M
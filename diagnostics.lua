@@ -0,0 +1,145 @@
+-- diagnostics.lua
+--
+-- clangd republishes hundreds of diagnostics per save on template errors,
+-- and every publish re-renders signs, underlines and virtual text for the
+-- whole buffer. This layer sits in between:
+--
+--  * publishes are batched per buffer, only the last one inside
+--    vim.g.neo_mittens_diagnostic_batch_ms (150) gets through
+--  * at most vim.g.neo_mittens_diagnostic_max_per_line (3) diagnostics per
+--    line and severity are kept
+--  * virtual text is only drawn for the lines on screen (plus a margin) and
+--    redrawn on scroll
+--  * nothing updates while in insert mode
+--
+-- The overview (overview.lua) hangs off DiagnosticChanged, which now only
+-- fires once per batch, and it debounces on top of that.
+
+local M = {}
+
+local margin = 20
+
+local function batch_ms() return vim.g.neo_mittens_diagnostic_batch_ms or 150 end
+local function max_per_line() return vim.g.neo_mittens_diagnostic_max_per_line or 3 end
+
+local function cap(diagnostics)
+  local seen, out = {}, {}
+  local limit = max_per_line()
+  for _, d in ipairs(diagnostics) do
+    local key = d.range.start.line .. ":" .. (d.severity or 1)
+    seen[key] = (seen[key] or 0) + 1
+    if seen[key] <= limit then table.insert(out, d) end
+  end
+  return out
+end
+
+local function batch_handler(handler)
+  local pending = {} -- uri -> { timer, args }
+  return function(err, result, ctx, config)
+    if not result or not result.uri then return handler(err, result, ctx, config) end
+    local key = result.uri .. "#" .. ctx.client_id
+    local entry = pending[key]
+    if not entry then
+      entry = { timer = vim.loop.new_timer() }
+      pending[key] = entry
+    end
+    result.diagnostics = cap(result.diagnostics or {})
+    entry.args = { err, result, ctx, config }
+    entry.timer:stop()
+    entry.timer:start(batch_ms(), 0, vim.schedule_wrap(function()
+      entry.timer:close()
+      pending[key] = nil
+      handler(unpack(entry.args))
+    end))
+  end
+end
+
+-- virtual text for the visible range only
+local shown = {} -- bufnr -> namespace -> { diagnostics, opts }
+
+local function visible(bufnr)
+  local ranges = {}
+  for _, win in ipairs(vim.fn.win_findbuf(bufnr)) do
+    local top = vim.fn.line("w0", win) - 1 - margin
+    local bot = vim.fn.line("w$", win) - 1 + margin
+    table.insert(ranges, { top, bot })
+  end
+  return ranges
+end
+
+local function render(namespace, bufnr)
+  local state = shown[bufnr] and shown[bufnr][namespace]
+  if not state or not vim.api.nvim_buf_is_valid(bufnr) then return end
+  local ranges = visible(bufnr)
+  local in_view = vim.tbl_filter(function(d)
+    for _, r in ipairs(ranges) do
+      if d.lnum >= r[1] and d.lnum <= r[2] then return true end
+    end
+    return false
+  end, state.diagnostics)
+  -- the builtin show only adds extmarks (vim.diagnostic.show is what hides
+  -- first), without this every scroll would stack another copy
+  vim.diagnostic.handlers.virtual_text.hide(namespace, bufnr)
+  vim.diagnostic.handlers.virtual_text.show(namespace, bufnr, in_view, state.opts)
+end
+
+local viewport_text = {
+  show = function(namespace, bufnr, diagnostics, opts)
+    shown[bufnr] = shown[bufnr] or {}
+    shown[bufnr][namespace] = {
+      diagnostics = diagnostics,
+      opts = vim.tbl_extend("force", opts, { virtual_text = opts.viewport_virtual_text }),
+    }
+    render(namespace, bufnr)
+  end,
+  hide = function(namespace, bufnr)
+    if shown[bufnr] then shown[bufnr][namespace] = nil end
+    vim.diagnostic.handlers.virtual_text.hide(namespace, bufnr)
+  end,
+}
+
+function M.setup()
+  if M.done then return end
+  M.done = true
+
+  vim.diagnostic.handlers.viewport_virtual_text = viewport_text
+  vim.diagnostic.config({
+    update_in_insert = false,
+    severity_sort = true,
+    underline = true,
+    signs = true,
+    virtual_text = false, -- the builtin one renders everything, ours renders the view
+    viewport_virtual_text = { spacing = 2, source = "if_many" },
+  })
+
+  require("neo-mittens.util").wrap(vim.lsp.handlers, "textDocument/publishDiagnostics", batch_handler)
+
+  local timer = vim.loop.new_timer()
+  M.timer = timer
+  local group = vim.api.nvim_create_augroup("NeoMittensDiagnostics", { clear = true })
+  vim.api.nvim_create_autocmd("WinScrolled", {
+    group = group,
+    callback = function()
+      timer:stop()
+      timer:start(50, 0, vim.schedule_wrap(function()
+        for _, win in ipairs(vim.api.nvim_list_wins()) do
+          local bufnr = vim.api.nvim_win_get_buf(win)
+          for namespace in pairs(shown[bufnr] or {}) do render(namespace, bufnr) end
+        end
+      end))
+    end,
+  })
+  vim.api.nvim_create_autocmd("BufWipeout", {
+    group = group,
+    callback = function(args) shown[args.buf] = nil end,
+  })
+end
+
+function M.teardown()
+  if not M.timer then return end
+  M.timer:stop()
+  M.timer:close()
+  M.timer = nil
+end
+
+return M
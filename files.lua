@@ -0,0 +1,219 @@
+-- files.lua
+--
+-- <leader>ff / <leader>ffh without re-walking the tree every time.
+--
+-- The file list is cached per project root (and hidden or not) under
+-- stdpath("cache")/neo-mittens/files, and the picker streams it straight
+-- from that file, so results show right away even right after a restart.
+-- Each open (and FocusGained) refreshes it in the background: `git
+-- ls-files` in a repo, filtered down to what fd would list (the excludes
+-- from telescope.lua, dotfiles unless <leader>ffh), the fd/rg find_command
+-- otherwise. The listing goes from the job into the cache file without
+-- passing through lua, and only when it changed does the picker (if still
+-- up) get the new one, keeping the prompt.
+--
+-- Files you open are ranked by frecency (count weighted by how recent), so
+-- with an empty prompt the ones you actually use come first.
+
+local M = {}
+
+local cache_dir = vim.fn.stdpath("cache") .. "/neo-mittens/files"
+local frecency_file = cache_dir .. "/frecency.json"
+
+local known = {}    -- key -> { root, cmd, filter }, what FocusGained refreshes
+local refreshing = {}
+local frecency      -- abs path -> { count, last }
+
+local function root_of(path)
+  local git = vim.fs.find(".git", { upward = true, path = path or vim.loop.cwd() })[1]
+  if git then return vim.fs.dirname(git), true end
+  return vim.loop.cwd(), false
+end
+
+local function cache_file(key)
+  return cache_dir .. "/" .. key:gsub("[/\\:]", "%%") .. ".txt"
+end
+
+local function load_frecency()
+  if frecency then return frecency end
+  frecency = {}
+  local f = io.open(frecency_file, "r")
+  if f then
+    local ok, data = pcall(vim.json.decode, f:read("*a"))
+    f:close()
+    if ok and type(data) == "table" then frecency = data end
+  end
+  return frecency
+end
+
+local function save_frecency()
+  if not frecency then return end
+  vim.fn.mkdir(cache_dir, "p")
+  vim.fn.writefile({ vim.json.encode(frecency) }, frecency_file)
+end
+
+local function score(entry)
+  local age = os.time() - entry.last
+  local weight = age < 4 * 3600 and 100
+      or age < 86400 and 80
+      or age < 3 * 86400 and 60
+      or age < 7 * 86400 and 40
+      or age < 30 * 86400 and 20
+      or 10
+  return entry.count * weight
+end
+
+-- the frecent files under root, best first, relative to root. Only walks
+-- the frecency table, never the file list.
+local function hot(root, limit)
+  local prefix = root .. "/"
+  local out = {}
+  for path, entry in pairs(load_frecency()) do
+    if vim.startswith(path, prefix) then table.insert(out, { path:sub(#prefix + 1), score(entry) }) end
+  end
+  table.sort(out, function(a, b) return a[2] > b[2] end)
+  local files = {}
+  for i = 1, math.min(limit, #out) do
+    if vim.loop.fs_stat(prefix .. out[i][1]) then table.insert(files, out[i][1]) end
+  end
+  return files
+end
+
+-- fd's --exclude globs (and, unless hidden, dotfiles) as one ERE over the
+-- paths git ls-files prints, so a repo gets the same list fd would give
+local function git_filter(opts)
+  local parts = {}
+  for _, glob in ipairs(opts.ignore or {}) do
+    table.insert(parts, (vim.fn.escape(glob, ".+?()[]{}|^$\\"):gsub("%*", "[^/]*")))
+  end
+  if not opts.hidden then table.insert(parts, "\\.[^/]*") end
+  if #parts == 0 then return "" end
+  return "(^|/)(" .. table.concat(parts, "|") .. ")(/|$)"
+end
+
+local function list_command(is_git, opts)
+  if is_git then return { "git", "ls-files", "--cached", "--others", "--exclude-standard" }, git_filter(opts) end
+  return opts.find_command, ""
+end
+
+-- Lists into the cache file straight from the job, the list itself never
+-- goes through lua. Exits 0 unchanged, 1 changed, anything else failed.
+local refresh_script = [[
+  out="$1" filter="$2"; shift 2
+  "$@" > "$out.raw" || { rm -f "$out.raw"; exit 2; }
+  if [ -n "$filter" ]; then grep -Ev -- "$filter" "$out.raw" > "$out.new"; rm -f "$out.raw"
+  else mv "$out.raw" "$out.new"; fi
+  if cmp -s "$out.new" "$out"; then rm -f "$out.new"; exit 0; fi
+  mv "$out.new" "$out"; exit 1
+]]
+
+-- done(code) with the script's exit code. A refresh already running for
+-- key gets done() queued onto it rather than starting another.
+function M.refresh(key, root, cmd, filter, done)
+  known[key] = { root, cmd, filter }
+  if refreshing[key] then
+    if done then table.insert(refreshing[key], done) end
+    return
+  end
+  refreshing[key] = { done }
+  vim.fn.mkdir(cache_dir, "p")
+  local job = { "sh", "-c", refresh_script, "sh", cache_file(key), filter or "" }
+  vim.list_extend(job, cmd)
+  require("neo-mittens.util").job(job, { cwd = root }, function(code)
+    local waiting = refreshing[key]
+    refreshing[key] = nil
+    for _, cb in ipairs(waiting) do cb(code) end
+  end)
+end
+
+-- opts.hidden, opts.ignore (fd style globs), opts.find_command (used
+-- outside git repos)
+function M.pick(opts)
+  opts = opts or {}
+  local root, is_git = root_of()
+  local cmd, filter = list_command(is_git, opts)
+  if not cmd then return require("telescope.builtin").find_files(opts) end
+  local key = root .. (opts.hidden and "#hidden" or "")
+  local file = cache_file(key)
+
+  if not vim.loop.fs_stat(file) then
+    -- nothing cached yet, the first listing is the slow one
+    return M.refresh(key, root, cmd, filter, function(code)
+      if (code == 0 or code == 1) and vim.loop.fs_stat(file) then return M.pick(opts) end
+      vim.notify(("files: listing %s failed (%s), falling back to find_files"):format(root, table.concat(cmd, " ")),
+        vim.log.levels.WARN)
+      require("telescope.builtin").find_files(opts)
+    end)
+  end
+
+  local pickers = require("telescope.pickers")
+  local finders = require("telescope.finders")
+  local make_entry = require("telescope.make_entry")
+  local conf = require("telescope.config").values
+
+  local picker_opts = { cwd = root }
+  local hot_file = vim.fn.tempname()
+  local function finder()
+    -- frecent first, then the cached listing streamed by cat, minus those
+    local first = hot(root, 200)
+    vim.fn.writefile(first, hot_file)
+    local seen = {}
+    for _, f in ipairs(first) do seen[f] = true end
+    local from_file = make_entry.gen_from_file(picker_opts)
+    local listed = 0
+    return finders.new_oneshot_job({ "sh", "-c", 'cat "$1" "$2"', "sh", hot_file, file }, {
+      cwd = root,
+      entry_maker = function(line)
+        listed = listed + 1
+        if listed > #first and seen[line] then return nil end
+        return from_file(line)
+      end,
+    })
+  end
+
+  local picker = pickers.new(picker_opts, {
+    prompt_title = "Find Files",
+    finder = finder(),
+    previewer = conf.file_previewer(picker_opts),
+    sorter = conf.file_sorter(picker_opts),
+  })
+  picker:find()
+
+  -- reconcile in the background, only a changed listing touches the picker
+  vim.defer_fn(function()
+    M.refresh(key, root, cmd, filter, function(code)
+      if code ~= 1 then return end
+      pcall(picker.refresh, picker, finder(), { reset_prompt = false })
+    end)
+  end, 0)
+end
+
+local group = vim.api.nvim_create_augroup("NeoMittensFiles", { clear = true })
+
+vim.api.nvim_create_autocmd("BufEnter", {
+  group = group,
+  callback = function(args)
+    if vim.bo[args.buf].buftype ~= "" then return end
+    local name = vim.api.nvim_buf_get_name(args.buf)
+    if name == "" then return end
+    local data = load_frecency()
+    local entry = data[name] or { count = 0, last = 0 }
+    entry.count = entry.count + 1
+    entry.last = os.time()
+    data[name] = entry
+  end,
+})
+
+vim.api.nvim_create_autocmd("VimLeavePre", { group = group, callback = save_frecency })
+
+-- reload.lua drops this module, the counts would go with it
+function M.teardown() save_frecency() end
+
+vim.api.nvim_create_autocmd("FocusGained", {
+  group = group,
+  callback = function()
+    for key, k in pairs(known) do M.refresh(key, k[1], k[2], k[3]) end
+  end,
+})
+
+return M
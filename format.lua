@@ -0,0 +1,162 @@
+-- format.lua
+--
+-- Async formatting for <A-S-f> and :NeoMittensFormat, so clang-format on a
+-- big file never blocks input.
+--
+-- Only what changed gets formatted: the gitsigns hunks (or the visual
+-- selection), sent as rangeFormatting requests one at a time from the bottom
+-- up so applied edits don't shift the ranges still to go. An answer that
+-- comes back after the buffer changed is dropped. One run per buffer at a
+-- time, pressing it again mid run just queues another pass.
+--
+-- Format on save (sync, bounded) is opt in:
+--   vim.g.neo_mittens_format_on_save = true
+--   vim.g.neo_mittens_format_on_save_timeout = 500 -- ms, for the whole save
+
+local util = require("neo-mittens.util")
+
+local M = {}
+
+local running = {}
+
+local function client_for(bufnr, method)
+  for _, client in ipairs(util.lsp_clients({ bufnr = bufnr })) do
+    if client.supports_method(method) then return client end
+  end
+end
+
+-- {first, last} 1-based inclusive line ranges that differ from the index,
+-- nil when gitsigns doesn't know the buffer (whole buffer gets formatted)
+local function changed_ranges(bufnr)
+  local gs = package.loaded.gitsigns
+  local hunks = gs and gs.get_hunks and gs.get_hunks(bufnr)
+  if not hunks then return nil end
+  local ranges = {}
+  for _, hunk in ipairs(hunks) do
+    if hunk.added.count > 0 then
+      table.insert(ranges, { hunk.added.start, hunk.added.start + hunk.added.count - 1 })
+    end
+  end
+  return ranges
+end
+
+local function params(bufnr, range)
+  local p = vim.lsp.util.make_formatting_params({})
+  p.textDocument = { uri = vim.uri_from_bufnr(bufnr) }
+  if range then
+    p.range = {
+      start = { line = range[1] - 1, character = 0 },
+      ["end"] = { line = range[2], character = 0 },
+    }
+  end
+  return p
+end
+
+-- A list of requests to make, bottom up. A nil range means the whole buffer.
+local function plan(bufnr, ranges)
+  local ranged = client_for(bufnr, "textDocument/rangeFormatting")
+  if ranges and ranged then
+    table.sort(ranges, function(a, b) return a[1] > b[1] end)
+    local steps = {}
+    for _, range in ipairs(ranges) do
+      table.insert(steps, { client = ranged, method = "textDocument/rangeFormatting", range = range })
+    end
+    return steps
+  end
+  local full = client_for(bufnr, "textDocument/formatting")
+  if full then
+    return { { client = full, method = "textDocument/formatting" } }
+  end
+  return {}
+end
+
+local function finish(bufnr, msg)
+  local state = running[bufnr]
+  running[bufnr] = nil
+  if msg then vim.notify("format: " .. msg, vim.log.levels.WARN) end
+  if state and state.again and vim.api.nvim_buf_is_valid(bufnr) then
+    M.format({ bufnr = bufnr })
+  end
+end
+
+-- opts.bufnr, opts.range = {first, last} to format just that
+function M.format(opts)
+  opts = opts or {}
+  local bufnr = opts.bufnr or vim.api.nvim_get_current_buf()
+  if running[bufnr] then
+    running[bufnr].again = true
+    return
+  end
+
+  local ranges = opts.range and { opts.range } or changed_ranges(bufnr)
+  if ranges and #ranges == 0 then return end -- nothing changed
+  local steps = plan(bufnr, ranges)
+  if #steps == 0 then
+    vim.notify("format: no attached client can format this buffer", vim.log.levels.WARN)
+    return
+  end
+
+  running[bufnr] = {}
+  local i = 0
+  local function step()
+    i = i + 1
+    local s = steps[i]
+    if not s then return finish(bufnr) end
+    local tick = vim.api.nvim_buf_get_changedtick(bufnr)
+    local sent = s.client.request(s.method, params(bufnr, s.range), function(err, result)
+      if not vim.api.nvim_buf_is_valid(bufnr) then return finish(bufnr) end
+      if err then return finish(bufnr, err.message) end
+      -- you kept typing, these edits are for text that isn't there anymore
+      if vim.api.nvim_buf_get_changedtick(bufnr) ~= tick then return finish(bufnr) end
+      if result then
+        vim.lsp.util.apply_text_edits(result, bufnr, s.client.offset_encoding)
+      end
+      step()
+    end, bufnr)
+    -- a stopping client never calls back, don't stay "running" forever
+    if not sent then finish(bufnr, s.client.name .. " is not running") end
+  end
+  step()
+end
+
+-- Mapping entry point, uses the selection in visual mode
+function M.format_mapping()
+  local mode = vim.fn.mode()
+  if mode == "v" or mode == "V" or mode == "\22" then
+    local a, b = vim.fn.line("v"), vim.fn.line(".")
+    vim.api.nvim_feedkeys(vim.api.nvim_replace_termcodes("<Esc>", true, false, true), "n", false)
+    M.format({ range = { math.min(a, b), math.max(a, b) } })
+  else
+    M.format()
+  end
+end
+
+-- Sync variant for BufWritePre, gives up when the timeout runs out
+local function format_sync(bufnr, timeout)
+  local deadline = vim.loop.now() + timeout
+  for _, s in ipairs(plan(bufnr, changed_ranges(bufnr))) do
+    local left = deadline - vim.loop.now()
+    if left <= 0 then return end
+    local res = s.client.request_sync(s.method, params(bufnr, s.range), left, bufnr)
+    if not res or res.err then return end
+    if res.result then
+      vim.lsp.util.apply_text_edits(res.result, bufnr, s.client.offset_encoding)
+    end
+  end
+end
+
+function M.setup()
+  vim.api.nvim_create_user_command("NeoMittensFormat", function(args)
+    M.format({ range = args.range > 0 and { args.line1, args.line2 } or nil })
+  end, { range = true })
+
+  vim.api.nvim_create_autocmd("BufWritePre", {
+    group = vim.api.nvim_create_augroup("NeoMittensFormat", { clear = true }),
+    callback = function(args)
+      if not vim.g.neo_mittens_format_on_save or running[args.buf] then return end
+      format_sync(args.buf, vim.g.neo_mittens_format_on_save_timeout or 500)
+    end,
+  })
+end
+
+return M
@@ -1,3 +1,74 @@
+local bigfile = require('neo-mittens.bigfile')
+
+-- Adaptive update debounce. gitsigns only has the one global update_debounce,
+-- so its per-buffer debounced update gets wrapped: small files go straight
+-- through, bigger ones (and ones whose recent diffs were slow) wait a bit
+-- longer first. Latency is measured from handing the update to gitsigns
+-- until its GitSignsUpdate event. bigfile.lua still turns it off entirely.
+local adaptive = { timers = {}, started = {}, latency = {} }
+
+function adaptive.delay(bufnr)
+  local lines = vim.api.nvim_buf_line_count(bufnr)
+  local by_size = math.floor(lines / 1000) * 10           -- 10ms per 1k lines
+  local by_latency = 4 * (adaptive.latency[bufnr] or 0)   -- back off when diffs are slow
+  return math.min(2000, math.max(by_size, by_latency))
+end
+
+function adaptive.wrap(update_debounced)
+  return function(bufnr, ...)
+    local args = { ... }
+    local delay = adaptive.delay(bufnr)
+    local function go()
+      adaptive.started[bufnr] = vim.loop.now()
+      update_debounced(bufnr, unpack(args))
+    end
+    if delay == 0 then return go() end
+
+    local timer = adaptive.timers[bufnr]
+    if not timer then
+      timer = vim.loop.new_timer()
+      adaptive.timers[bufnr] = timer
+    end
+    timer:stop()
+    timer:start(delay, 0, vim.schedule_wrap(go))
+  end
+end
+
+-- Called from on_attach, by then gitsigns has built its debounced update.
+-- Re-wraps if gitsigns ever rebuilt it, util.wrap makes sure a reloaded
+-- gitsigns.lua doesn't wrap the previous wrapper.
+function adaptive.install()
+  local ok, manager = pcall(require, 'gitsigns.manager')
+  if not ok or type(manager.update_debounced) ~= 'function' then return end
+  if manager.update_debounced == adaptive.wrapper then return end
+  adaptive.wrapper = require('neo-mittens.util').wrap(manager, 'update_debounced', adaptive.wrap)
+end
+
+local group = vim.api.nvim_create_augroup('NeoMittensGitsigns', { clear = true })
+vim.api.nvim_create_autocmd('User', {
+  group = group,
+  pattern = 'GitSignsUpdate',
+  callback = function(args)
+    local bufnr = args.data and args.data.buffer
+    local started = bufnr and adaptive.started[bufnr]
+    if not started then return end
+    adaptive.started[bufnr] = nil
+    local took = math.max(0, vim.loop.now() - started - 100) -- minus the base debounce
+    local prev = adaptive.latency[bufnr] or took
+    adaptive.latency[bufnr] = math.floor(prev * 0.7 + took * 0.3)
+  end,
+})
+vim.api.nvim_create_autocmd('BufWipeout', {
+  group = group,
+  callback = function(args)
+    local timer = adaptive.timers[args.buf]
+    if timer then timer:close() end
+    adaptive.timers[args.buf] = nil
+    adaptive.started[args.buf] = nil
+    adaptive.latency[args.buf] = nil
+  end,
+})
+
 require('gitsigns').setup({
   signs                        = {
     add          = { text = '│' },
@@ -15,7 +86,7 @@ require('gitsigns').setup({
     follow_files = true
   },
   attach_to_untracked          = true,
-  current_line_blame           = false, -- Toggle with `:Gitsigns toggle_current_line_blame`
+  current_line_blame           = false, -- Our cached one in blame.lua is on <leader>tb
   current_line_blame_opts      = {
     virt_text = true,
     virt_text_pos = 'eol', -- 'eol' | 'overlay' | 'right_align'
@@ -25,9 +96,9 @@ require('gitsigns').setup({
   },
   current_line_blame_formatter = '<author>, <author_time:%Y-%m-%d> - <summary>',
   sign_priority                = 6,
-  update_debounce              = 100,
+  update_debounce              = 100,   -- base, bigger/slower buffers wait longer, see below
   status_formatter             = nil,   -- Use default
-  max_file_length              = 40000, -- Disable if file is longer than this (in lines)
+  max_file_length              = math.huge, -- no cliff of its own, on_attach asks bigfile.lua instead
   preview_config               = {
     -- Options passed to nvim_open_win
     border = 'single',
@@ -39,7 +110,12 @@ require('gitsigns').setup({
   yadm                         = {
     enable = false
   },
-  on_attach                    = function(bufnr)
+  on_attach                    = require('neo-mittens.stalls').wrap('gitsigns on_attach', function(bufnr)
+    if bigfile.is_big(bufnr) then return false end -- returning false skips the attach
+    adaptive.install()
+    -- re-attaching (after a detach, or a :Gitsigns attach) keeps the old maps
+    if vim.b[bufnr].neo_mittens_gitsigns_maps then return end
+    vim.b[bufnr].neo_mittens_gitsigns_maps = true
     local gs = package.loaded.gitsigns
 
     local function map(mode, l, r, opts)
@@ -70,13 +146,15 @@ require('gitsigns').setup({
     map('n', '<leader>hu', gs.undo_stage_hunk)
     map('n', '<leader>hR', gs.reset_buffer)
     map('n', '<leader>hp', gs.preview_hunk)
-    map('n', '<leader>hb', function() gs.blame_line { full = true } end)
-    map('n', '<leader>tb', gs.toggle_current_line_blame)
+    -- blame comes out of the shared cache in blame.lua, full popup stays gitsigns
+    map('n', '<leader>hb', function() require('neo-mittens.blame').blame_line() end)
+    map('n', '<leader>hB', function() gs.blame_line { full = true } end)
+    map('n', '<leader>tb', function() require('neo-mittens.blame').toggle() end)
     map('n', '<leader>hd', gs.diffthis)
     map('n', '<leader>hD', function() gs.diffthis('~') end)
     map('n', '<leader>td', gs.toggle_deleted)
 
     -- Text object
     map({ 'o', 'x' }, 'ih', ':<C-U>Gitsigns select_hunk<CR>')
-  end
+  end),
 })
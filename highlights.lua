@@ -0,0 +1,91 @@
+-- highlights.lua
+--
+-- gruvbox, the transparent background and the Rainbow* groups for the
+-- indent guides used to be three separate passes over the highlights at
+-- startup (colorscheme, settings.lua, the ibl hook), and the screen flashed
+-- for each. Now the end result is compiled into one Lua file under
+-- stdpath("cache")/neo-mittens/highlights and applied in a single pass from
+-- lazy.lua, before anything is drawn. gruvbox itself then only gets loaded
+-- when something runs :colorscheme (or 'background' changes).
+--
+-- The file name is a hash of the colorscheme, 'background', gruvbox's
+-- source mtime and the overrides below, so changing any of them just
+-- compiles a new one on the next ColorScheme.
+
+local M = {}
+
+M.colorscheme = "gruvbox"
+
+-- see through to the terminal background
+M.overrides = {
+  Normal = { bg = "NONE" },
+  SignColumn = { bg = "NONE" },
+}
+
+-- indent guide colors, indent-config.lua hands these to ibl
+M.rainbow = {
+  RainbowRed = { fg = "#E06C75" },
+  RainbowYellow = { fg = "#E5C07B" },
+  RainbowBlue = { fg = "#61AFEF" },
+  RainbowOrange = { fg = "#D19A66" },
+  RainbowGreen = { fg = "#98C379" },
+  RainbowViolet = { fg = "#C678DD" },
+  RainbowCyan = { fg = "#56B6C2" },
+}
+
+local cache_dir = vim.fn.stdpath("cache") .. "/neo-mittens/highlights"
+local source = vim.fn.stdpath("data") .. "/lazy/gruvbox.nvim/lua/gruvbox.lua"
+
+local function cache_file()
+  local stat = vim.loop.fs_stat(source)
+  local key = vim.inspect({
+    M.colorscheme, vim.o.background, stat and stat.mtime.sec or 0, M.overrides, M.rainbow,
+  })
+  return ("%s/%s.lua"):format(cache_dir, vim.fn.sha256(key):sub(1, 16))
+end
+
+-- transparency and rainbow on top of whatever colorscheme is loaded
+function M.apply_overrides()
+  for name, attrs in pairs(M.overrides) do
+    local hl = vim.api.nvim_get_hl and vim.api.nvim_get_hl(0, { name = name, link = false }) or {}
+    for k, v in pairs(attrs) do hl[k] = v ~= "NONE" and v or nil end
+    vim.api.nvim_set_hl(0, name, hl)
+  end
+  for name, attrs in pairs(M.rainbow) do vim.api.nvim_set_hl(0, name, attrs) end
+end
+
+-- Applies the compiled highlights if there are any for the current
+-- settings. Returns false when gruvbox has to be loaded for real.
+function M.load()
+  local chunk = loadfile(cache_file())
+  if not chunk then return false end
+  local ok, compiled = pcall(chunk)
+  if not ok or type(compiled) ~= "table" then return false end
+
+  for name, attrs in pairs(compiled.groups) do vim.api.nvim_set_hl(0, name, attrs) end
+  for name, value in pairs(compiled.globals) do vim.g[name] = value end
+  vim.g.colors_name = M.colorscheme -- so a 'background' change reloads the real thing
+  return true
+end
+
+-- Snapshots the current highlights (colorscheme + overrides) into the cache
+function M.compile()
+  if not vim.api.nvim_get_hl then return end -- 0.9+
+  local compiled = { groups = vim.api.nvim_get_hl(0, {}), globals = {} }
+  for i = 0, 15 do
+    compiled.globals["terminal_color_" .. i] = vim.g["terminal_color_" .. i]
+  end
+  vim.fn.mkdir(cache_dir, "p")
+  -- one item per line, writefile() would turn NLs inside an item into NULs
+  vim.fn.writefile(vim.split("return " .. vim.inspect(compiled), "\n"), cache_file())
+end
+
+vim.api.nvim_create_autocmd("ColorScheme", {
+  group = vim.api.nvim_create_augroup("NeoMittensHighlights", { clear = true }),
+  callback = function(args)
+    M.apply_overrides()
+    if args.match == M.colorscheme then vim.schedule(M.compile) end
+  end,
+})
+
+return M
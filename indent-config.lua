@@ -8,17 +8,62 @@ local highlight = {
     "RainbowCyan",
 }
 
+-- same colors highlights.lua compiles in, the hook below puts them back
+-- whenever ibl redoes its highlights
+local colors = require("neo-mittens.highlights").rainbow
+
 local hooks = require "ibl.hooks"
+-- hooks only ever get added, start over so :NeoMittensReload doesn't stack them
+hooks.clear_all()
+
 -- create the highlight groups in the highlight setup hook, so they are reset
 -- every time the colorscheme changes
 hooks.register(hooks.type.HIGHLIGHT_SETUP, function()
-    vim.api.nvim_set_hl(0, "RainbowRed", { fg = "#E06C75" })
-    vim.api.nvim_set_hl(0, "RainbowYellow", { fg = "#E5C07B" })
-    vim.api.nvim_set_hl(0, "RainbowBlue", { fg = "#61AFEF" })
-    vim.api.nvim_set_hl(0, "RainbowOrange", { fg = "#D19A66" })
-    vim.api.nvim_set_hl(0, "RainbowGreen", { fg = "#98C379" })
-    vim.api.nvim_set_hl(0, "RainbowViolet", { fg = "#C678DD" })
-    vim.api.nvim_set_hl(0, "RainbowCyan", { fg = "#56B6C2" })
+    for _, name in ipairs(highlight) do
+        vim.api.nvim_set_hl(0, name, colors[name])
+    end
+end)
+
+-- no guides on big files, see bigfile.lua
+hooks.register(hooks.type.ACTIVE, function(bufnr)
+    return not require("neo-mittens.bigfile").is_big(bufnr)
 end)
 
-require("ibl").setup { indent = { highlight = highlight } }
+-- "fast indent guides", on unless vim.g.neo_mittens_fast_indent = false.
+-- Only renders around the viewport, stops drawing guides past
+-- neo_mittens_indent_max_depth levels, and only does scope when treesitter is
+-- already highlighting the buffer (so it never pulls a parser in by itself).
+if vim.g.neo_mittens_fast_indent == false then
+    require("ibl").setup { indent = { highlight = highlight } }
+    return
+end
+
+local max_depth = vim.g.neo_mittens_indent_max_depth or 8
+
+local whitespace = require("ibl.indent").whitespace
+hooks.register(hooks.type.WHITESPACE, function(_, _, _, whitespace_tbl)
+    local depth = 0
+    for i, ws in ipairs(whitespace_tbl) do
+        if ws == whitespace.INDENT or ws == whitespace.TAB_START or ws == whitespace.TAB_START_SINGLE then
+            depth = depth + 1
+        end
+        if depth > max_depth then
+            whitespace_tbl[i] = whitespace.SPACE
+        end
+    end
+    return whitespace_tbl
+end)
+
+hooks.register(hooks.type.SCOPE_ACTIVE, function(bufnr)
+    return vim.treesitter.highlighter.active[bufnr] ~= nil
+end)
+
+require("ibl").setup {
+    indent = { highlight = highlight },
+    viewport_buffer = { min = 20, max = 100 },
+    scope = { enabled = true, show_start = false, show_end = false },
+    exclude = {
+        filetypes = { "help", "TelescopePrompt", "TelescopeResults", "lazy", "mason", "gitcommit", "minimap" },
+        buftypes = { "terminal", "nofile", "quickfix", "prompt" },
+    },
+}
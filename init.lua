@@ -1,16 +1,22 @@
+-- Bytecode cache for every require after this, so it has to come first.
+-- `NEO_MITTENS_NO_CACHE=1 nvim` to debug without it (lazy.lua checks it too).
+if vim.loader and not vim.env.NEO_MITTENS_NO_CACHE then
+  vim.loader.enable()
+end
+
+-- Opt-in hitch hunting, first so it sees every autocmd, see stalls.lua
+if vim.g.neo_mittens_stalls or vim.env.NEO_MITTENS_STALLS then
+  require("neo-mittens.stalls").start()
+end
+
 -- Example using a list of specs with the default options
 vim.g.mapleader = " "                     -- Make sure to set `mapleader` before lazy so your mappings are correct
 
-require("neo-mittens.lazy")               -- Dependencies
+require("neo-mittens.bigfile")            -- Must beat the plugins to BufReadPre
+require("neo-mittens.lazy")               -- Dependencies, plugin setup is in the lazy specs now
 if not vim.g.vscode then
-  require("neo-mittens.lsp-config")       -- LSP shit
-  require("neo-mittens.treesitter-config") -- Syntax highlighting shit
-  require("neo-mittens.telescope")
-  require("neo-mittens.indent-config")
   require("neo-mittens.term-config")
-  require("neo-mittens.gitsigns")
-  require("mini.map").setup() -- File minimapA
-  vim.cmd.colorscheme("gruvbox")
+  require("neo-mittens.files")            -- Cheap, just tracks frecency until <leader>ff
 end
 
 require("neo-mittens.settings")
@@ -0,0 +1,136 @@
+-- install.lua
+--
+-- One headless entry point for baking the config into an image:
+--
+--   nvim --headless -c 'lua require("neo-mittens.install").cli()'
+--
+-- Installs the lazy plugins (restored to lazy-lock.json when it exists,
+-- otherwise installed and the lockfile written next to lazy.lua, commit it;
+-- NEO_MITTENS_REQUIRE_LOCK=1 refuses to install without one),
+-- then the Mason packages for `M.servers` and the treesitter parsers from
+-- ts-bootstrap.lua side by side. Each kind runs at most
+-- $NEO_MITTENS_INSTALL_JOBS / vim.g.neo_mittens_install_jobs jobs at once
+-- (default core count). Exits non-zero when anything failed.
+--
+-- Only what's missing is fetched: lazy skips plugins that are already
+-- checked out, Mason skips installed packages, and parsers live in the
+-- per-revision cache. Keep stdpath("data") (plugins and Mason) and the
+-- parser cache in their own layers, ordered roughly by how often they
+-- change, and rebuilds only redo what changed.
+
+local util = require("neo-mittens.util")
+
+local M = {}
+
+-- lspconfig names, lsp-config.lua hands these to lsp-zero as well
+M.servers = {
+  'lua_ls',
+  'clangd',
+  -- 'tsserver',
+  -- 'eslint',
+  --'sumneko_lua',
+  --'rust_analyzer',
+}
+
+local function jobs()
+  return tonumber(vim.env.NEO_MITTENS_INSTALL_JOBS) or vim.g.neo_mittens_install_jobs or util.cpu_count()
+end
+
+local function log(msg)
+  io.stderr:write("neo-mittens: " .. msg .. "\n")
+end
+
+local function install_plugins(limit, failed)
+  local config = require("lazy.core.config")
+  config.options.concurrency = limit
+  local lazy = require("lazy")
+  if vim.loop.fs_stat(config.options.lockfile) then
+    lazy.restore({ wait = true, show = false })
+  elseif vim.env.NEO_MITTENS_REQUIRE_LOCK then
+    table.insert(failed, "no " .. config.options.lockfile .. " to restore from")
+    return
+  else
+    lazy.install({ wait = true, show = false })
+    -- lazy writes the lockfile after installing
+    log("wrote " .. config.options.lockfile .. ", commit it so installs are pinned from now on")
+  end
+  for name, plugin in pairs(config.plugins) do
+    if not (plugin._ and plugin._.installed) then table.insert(failed, "plugin " .. name) end
+  end
+end
+
+local function package_name(server)
+  local ok, mappings = pcall(require, "mason-lspconfig.mappings.server")
+  return ok and mappings.lspconfig_to_package[server] or server
+end
+
+-- Starts the Mason installs, returns a function telling whether they're done
+local function install_packages(limit, failed)
+  require("lazy").load({ plugins = { "mason.nvim", "mason-lspconfig.nvim" } })
+  require("mason").setup()
+  local registry = require("mason-registry")
+
+  local queue, running, refreshed = {}, 0, false
+  local function pump()
+    while running < limit and #queue > 0 do
+      local pkg = table.remove(queue, 1)
+      running = running + 1
+      log("installing " .. pkg.name)
+      pkg:install():once("closed", vim.schedule_wrap(function()
+        running = running - 1
+        if not pkg:is_installed() then table.insert(failed, "mason " .. pkg.name) end
+        pump()
+      end))
+    end
+  end
+
+  registry.refresh(function()
+    for _, server in ipairs(M.servers) do
+      local name = package_name(server)
+      local ok, pkg = pcall(registry.get_package, name)
+      if not ok then
+        table.insert(failed, "mason " .. name)
+      elseif not pkg:is_installed() then
+        table.insert(queue, pkg)
+      end
+    end
+    refreshed = true
+    pump()
+  end)
+
+  return function() return refreshed and running == 0 and #queue == 0 end
+end
+
+-- Returns the list of things that failed, empty when all went fine
+function M.run()
+  local limit = jobs()
+  local failed = {}
+
+  log("plugins, " .. limit .. " at a time")
+  install_plugins(limit, failed)
+
+  local mason_done = install_packages(limit, failed)
+  -- parsers compile while Mason downloads, the waiting in there keeps the loop going
+  log("treesitter parsers")
+  local ok, missing = require("neo-mittens.ts-bootstrap").bootstrap({ jobs = limit })
+  if not ok then
+    for _, lang in ipairs(missing) do table.insert(failed, "parser " .. lang) end
+  end
+  vim.wait(30 * 60 * 1000, mason_done, 200)
+  if not mason_done() then table.insert(failed, "mason timed out") end
+
+  return failed
+end
+
+function M.cli()
+  local ok, failed = pcall(M.run)
+  if not ok then failed = { tostring(failed) } end
+  if #failed > 0 then
+    log("failed: " .. table.concat(failed, ", "))
+    vim.cmd("cquit 1")
+  end
+  log("done")
+  vim.cmd("qall!")
+end
+
+return M
@@ -0,0 +1,97 @@
+-- lazy-bootstrap.lua
+--
+-- Gets lazy.nvim onto disk without freezing the UI, then calls back so
+-- lazy.lua can run setup. Runs once on a fresh box and does nothing after.
+--
+--  * the clone runs as a job, and git's progress goes to the message area
+--  * lazy.nvim is pinned to the commit in our lazy-lock.json (next to
+--    lazy.lua) when there is one, otherwise stable
+--  * offline installs:
+--      NEO_MITTENS_LAZY_TARBALL=/path/lazy.nvim.tar.gz  unpacked instead of cloning
+--      NEO_MITTENS_GIT_MIRROR=file:///srv/git           clone from <mirror>/folke/lazy.nvim.git,
+--                                                       lazy.lua uses it for plugins too
+--  * when the clone fails, setup is skipped with an error instead of blowing
+--    up halfway through
+--
+-- Headless (image builds, `nvim --headless "+Lazy! sync"`), it blocks until
+-- done, because the commands after it need lazy.
+
+local M = {}
+
+local function read_lock(lockfile)
+  local f = io.open(lockfile, "r")
+  if not f then return {} end
+  local ok, lock = pcall(vim.json.decode, f:read("*a"))
+  f:close()
+  return ok and type(lock) == "table" and lock or {}
+end
+
+function M.url(repo)
+  local mirror = vim.env.NEO_MITTENS_GIT_MIRROR
+  if mirror then return mirror .. "/" .. repo .. ".git" end
+  return "https://github.com/" .. repo .. ".git"
+end
+
+local function steps(lazypath, lockfile)
+  local tarball = vim.env.NEO_MITTENS_LAZY_TARBALL
+  if tarball then
+    vim.fn.mkdir(lazypath, "p")
+    return { { "tar", "-xzf", tarball, "-C", lazypath, "--strip-components=1" } }
+  end
+
+  local pin = (read_lock(lockfile)["lazy.nvim"] or {}).commit
+  local clone = { "git", "clone", "--progress", "--filter=blob:none", M.url("folke/lazy.nvim") }
+  if not pin then table.insert(clone, "--branch=stable") end -- latest stable release
+  table.insert(clone, lazypath)
+  local out = { clone }
+  if pin then table.insert(out, { "git", "-C", lazypath, "checkout", "--quiet", pin }) end
+  return out
+end
+
+local function echo(msg, hl)
+  vim.api.nvim_echo({ { "lazy.nvim: " .. msg, hl } }, false, {})
+  vim.cmd("redraw")
+end
+
+-- on_ready() runs once lazy.nvim is there, never when it isn't
+function M.ensure(lazypath, lockfile, on_ready)
+  if vim.loop.fs_stat(lazypath) then return on_ready() end
+
+  local headless = #vim.api.nvim_list_uis() == 0
+  local todo = steps(lazypath, lockfile)
+  local i = 0
+
+  local function fail(cmd, code)
+    vim.fn.delete(lazypath, "rf") -- so the next start tries again
+    vim.notify(("lazy.nvim: `%s` failed (%d), plugins are not loaded"):format(table.concat(cmd, " "), code),
+      vim.log.levels.ERROR)
+  end
+
+  local function next_step()
+    i = i + 1
+    local cmd = todo[i]
+    if not cmd then
+      echo("ready")
+      return on_ready()
+    end
+    local id = vim.fn.jobstart(cmd, {
+      on_stderr = function(_, data)
+        -- git progress is \r separated, the last bit is the freshest
+        local last = (data[#data] ~= "" and data[#data]) or data[#data - 1] or ""
+        last = last:match("([^\r]*)\r?$") or last
+        if last ~= "" and not headless then echo(last) end
+      end,
+      on_exit = function(_, code)
+        if code ~= 0 then return fail(cmd, code) end
+        next_step()
+      end,
+    })
+    if id <= 0 then return fail(cmd, id) end
+    if headless then vim.fn.jobwait({ id }) end
+  end
+
+  echo("installing...")
+  next_step()
+end
+
+return M
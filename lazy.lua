@@ -1,36 +1,82 @@
 local lazypath = vim.fn.stdpath("data") .. "/lazy/lazy.nvim"
-if not vim.loop.fs_stat(lazypath) then
-  vim.fn.system({
-    "git",
-    "clone",
-    "--filter=blob:none",
-    "https://github.com/folke/lazy.nvim.git",
-    "--branch=stable", -- latest stable release
-    lazypath,
-  })
-end
+-- the lockfile lives in this repo, right next to this file
+local dir = vim.fn.fnamemodify(debug.getinfo(1, "S").source:sub(2), ":p:h")
+local lockfile = dir .. "/lazy-lock.json"
+local bootstrap = require("neo-mittens.lazy-bootstrap")
+
+-- Everything below is lazy, the per-module setup lives in `config` so a quick
+-- `git commit` buffer doesn't pay for lsp / completion / minimap.
+-- Inside vscode the list at the bottom is used instead, the `cond`s below
+-- just make sure nothing heavy sneaks onto the rtp if that ever changes.
+local not_vscode = not vim.g.vscode
+local caching = not vim.env.NEO_MITTENS_NO_CACHE
+
+-- compiled gruvbox + overrides, applied right here before the first redraw.
+-- While they're valid gruvbox itself stays lazy, see highlights.lua
+local highlights_cached = not_vscode and require("neo-mittens.highlights").load()
+
+-- filetypes we actually run language servers for
+local lsp_filetypes = { "c", "cpp", "objc", "objcpp", "cuda", "proto", "lua" }
 
+-- only one scroll indicator gets loaded, see overview.lua
+local overview = vim.g.neo_mittens_overview or "scrollview"
+local toggle_overview = {
+  { "<leader>tm", function() require("neo-mittens.overview").toggle() end, desc = "Toggle overview" },
+}
 
-vim.opt.rtp:prepend(lazypath)
-require("lazy").setup({
-  "folke/which-key.nvim",
+local spec = {
+  { "folke/which-key.nvim",     event = "VeryLazy" },
   -- { "folke/neoconf.nvim",       cmd = "Neoconf" },
   {
     "nvim-treesitter/nvim-treesitter",
-    build = ":TSUpdate",
+    -- parsers are compiled into a per-revision cache, see ts-bootstrap.lua
+    build = function() require("neo-mittens.ts-bootstrap").bootstrap({ wait = false }) end,
+    cond = not_vscode,
+    event = { "BufReadPost", "BufNewFile" },
+    cmd = { "TSInstall", "TSUpdate", "TSUpdateSync", "TSInstallInfo" },
+    config = function() require("neo-mittens.treesitter-config") end,
+  },
+  { "folke/neodev.nvim",        lazy = true },
+  {
+    "ellisonleao/gruvbox.nvim",
+    priority = 1000,
+    lazy = highlights_cached,
+    cond = not_vscode,
+    -- when lazy, it loads on :colorscheme gruvbox, which then does the rest
+    config = function()
+      if not highlights_cached then vim.cmd.colorscheme("gruvbox") end
+    end,
   },
-  "folke/neodev.nvim",
-  { "ellisonleao/gruvbox.nvim", priority = 1000 },
   {
     'nvim-telescope/telescope.nvim',
     -- tag = '0.1.2',
-    dependencies = { 'nvim-lua/plenary.nvim' }
+    dependencies = {
+      'nvim-lua/plenary.nvim',
+      { 'nvim-telescope/telescope-fzf-native.nvim', build = 'make' },
+    },
+    cond = not_vscode,
+    cmd = "Telescope",
+    -- the real mappings are set by telescope.lua, these just trigger the load
+    keys = {
+      "<leader>ff", "<leader>ffh", "<leader>fg", "<leader>fb", "<leader>fh",
+      "<leader>fq", "<leader>fqq", "<leader>fj", "<leader>fm", "<leader>fr",
+      "<leader>fo", "<leader>fd", "<leader>fs", "<leader>fws",
+    },
+    config = function() require("neo-mittens.telescope") end,
   },
-  { 'scalameta/nvim-metals',    dependencies = { "nvim-lua/plenary.nvim" } },
-  { 'mfussenegger/nvim-dap' },
+  { "nvim-lua/plenary.nvim",    lazy = true },
+  {
+    'scalameta/nvim-metals',
+    dependencies = { "nvim-lua/plenary.nvim", "mfussenegger/nvim-dap" },
+    ft = { "scala", "sbt", "java" },
+  },
+  { 'mfussenegger/nvim-dap',    lazy = true },
   {
     'VonHeikemen/lsp-zero.nvim',
     branch = 'v2.x',
+    cond = not_vscode,
+    ft = lsp_filetypes,
+    cmd = { "Mason", "MasonInstall", "MasonUpdate", "LspInfo", "LspInstall" },
     dependencies = {
       -- LSP Support
       { 'neovim/nvim-lspconfig' },
@@ -46,13 +92,85 @@ require("lazy").setup({
       { 'hrsh7th/nvim-cmp' },
       { 'hrsh7th/cmp-nvim-lsp' },
       { 'L3MON4D3/LuaSnip' },
-    }
+    },
+    config = function() require("neo-mittens.lsp-config") end,
+  },
+  {
+    'echasnovski/mini.map',
+    version = '*',
+    cond = not_vscode and overview == "minimap",
+    event = { "BufReadPost", "BufNewFile" },
+    keys = toggle_overview,
+    config = function() require("neo-mittens.overview") end,
+  },
+  {
+    'dstein64/nvim-scrollview',
+    cond = not_vscode and overview == "scrollview",
+    event = { "BufReadPost", "BufNewFile" },
+    keys = toggle_overview,
+    config = function() require("neo-mittens.overview") end,
+  },
+  {
+    "lukas-reineke/indent-blankline.nvim",
+    main = "ibl",
+    cond = not_vscode,
+    event = { "BufReadPost", "BufNewFile" },
+    config = function() require("neo-mittens.indent-config") end,
   },
-  { 'echasnovski/mini.map',               version = '*' },
-  { 'dstein64/nvim-scrollview' },
-  { "lukas-reineke/indent-blankline.nvim" },
   -- { "airblade/vim-gitgutter" },
-  { "lewis6991/gitsigns.nvim" },
-  { 'tpope/vim-fugitive' },
-  { 'tpope/vim-rhubarb' },
-})
+  {
+    "lewis6991/gitsigns.nvim",
+    cond = not_vscode,
+    event = { "BufReadPre", "BufNewFile" },
+    config = function() require("neo-mittens.gitsigns") end,
+  },
+  {
+    'tpope/vim-fugitive',
+    dependencies = { 'tpope/vim-rhubarb' },
+    cmd = { "G", "Git", "Gdiffsplit", "Gvdiffsplit", "Gread", "Gwrite", "GBrowse", "Gedit", "Gblame" },
+  },
+  { 'tpope/vim-rhubarb',        lazy = true },
+}
+
+-- vscode-neovim does the UI, lsp, git and file finding itself, so embedded
+-- nvim only gets editing plugins (motions, text objects). They go in their
+-- own plugin dir with their own lockfile, so a :Lazy clean in there can't
+-- wipe the real set. While it's empty lazy isn't even bootstrapped.
+local vscode_spec = {}
+
+local opts = {
+  lockfile = lockfile,
+  git = vim.env.NEO_MITTENS_GIT_MIRROR and { url_format = vim.env.NEO_MITTENS_GIT_MIRROR .. "/%s.git" } or nil,
+  performance = {
+    cache = { enabled = caching },
+    reset_packpath = true,
+    rtp = {
+      reset = true,
+      -- netrw stays, <leader>e / <leader>E use it
+      disabled_plugins = {
+        "gzip",
+        "tarPlugin",
+        "zipPlugin",
+        "tohtml",
+        "tutor",
+        "getscriptPlugin",
+        "vimballPlugin",
+        "logipat",
+        "rrhelper",
+      },
+    },
+  },
+}
+
+if vim.g.vscode then
+  if #vscode_spec == 0 then return end
+  spec = vscode_spec
+  opts.root = vim.fn.stdpath("data") .. "/lazy-vscode"
+  opts.lockfile = dir .. "/lazy-lock-vscode.json"
+end
+
+-- lazy.nvim may not be there yet on a fresh box, see lazy-bootstrap.lua
+bootstrap.ensure(lazypath, opts.lockfile, function()
+  vim.opt.rtp:prepend(lazypath)
+  require("lazy").setup(spec, opts)
+end)
@@ -0,0 +1,203 @@
+-- lsp-cache.lua
+--
+-- References (<leader>vrr) and outgoing calls (<leader>fo) on a hot symbol
+-- take clangd seconds each time, so results are cached per symbol:
+--
+--  * an entry is reachable from the spot it was asked from. References are
+--    also reachable from every location in their results, so asking again
+--    from any reference of the same symbol is instant. Outgoing calls are
+--    keyed by the origin alone, their results are the callees, not the
+--    symbol that was asked about
+--  * editing a file (didChange) drops only the entries that point into it
+--  * the picker opens right away and fills in when clangd answers, instead
+--    of sitting there until the whole response is in
+--  * vim.g.neo_mittens_lsp_prefetch = true also asks for references of the
+--    symbol under the cursor on CursorHold
+
+local util = require("neo-mittens.util")
+
+local M = {}
+
+local max_entries = 200
+
+local entries = {} -- id -> { kind, items, files = { uri = true }, seq }
+local index = {}   -- "kind|uri|line|col" -> id
+local next_id = 0
+local inflight = {}
+
+local function key(kind, uri, line, col)
+  return table.concat({ kind, uri, line, col }, "|")
+end
+
+local function forget(id)
+  local entry = entries[id]
+  if not entry then return end
+  for _, k in ipairs(entry.keys) do
+    if index[k] == id then index[k] = nil end
+  end
+  entries[id] = nil
+end
+
+local function store(kind, origin, locations, items)
+  next_id = next_id + 1
+  local entry = { kind = kind, items = items, files = { [origin.uri] = true }, keys = {}, seq = next_id }
+  local function alias(uri, line, col)
+    local k = key(kind, uri, line, col)
+    index[k] = next_id
+    table.insert(entry.keys, k)
+  end
+  alias(origin.uri, origin.line, origin.col)
+  for _, loc in ipairs(locations) do
+    entry.files[loc.uri] = true
+    -- every reference is the same symbol, a callee is a different one
+    if kind == "references" then alias(loc.uri, loc.range.start.line, loc.range.start.character) end
+  end
+  entries[next_id] = entry
+
+  -- keep it bounded, oldest go first
+  if vim.tbl_count(entries) > max_entries then
+    local oldest
+    for id in pairs(entries) do
+      if not oldest or id < oldest then oldest = id end
+    end
+    forget(oldest)
+  end
+end
+
+local function invalidate(uri)
+  for id, entry in pairs(entries) do
+    if entry.files[uri] then forget(id) end
+  end
+end
+
+-- uri / 0-based line / start of the word under the cursor
+local function origin()
+  local row, col = unpack(vim.api.nvim_win_get_cursor(0))
+  local line = vim.api.nvim_get_current_line()
+  while col > 0 and line:sub(col, col):match("[%w_]") do col = col - 1 end
+  return { uri = vim.uri_from_bufnr(0), line = row - 1, col = col }
+end
+
+local function client_for(bufnr, method)
+  for _, client in ipairs(util.lsp_clients({ bufnr = bufnr })) do
+    if client.supports_method(method) then return client end
+  end
+end
+
+local function to_items(locations, encoding)
+  return vim.lsp.util.locations_to_items(locations, encoding)
+end
+
+-- references: fetch(cb(locations, items)) for the cursor in bufnr
+local function fetch_references(bufnr, cb)
+  local client = client_for(bufnr, "textDocument/references")
+  if not client then return cb(nil) end
+  local params = vim.lsp.util.make_position_params(0, client.offset_encoding)
+  params.context = { includeDeclaration = true }
+  client.request("textDocument/references", params, function(err, result)
+    if err or not result then return cb(nil) end
+    cb(result, to_items(result, client.offset_encoding))
+  end, bufnr)
+end
+
+-- outgoing calls: prepare the hierarchy item, then ask what it calls
+local function fetch_outgoing(bufnr, cb)
+  local client = client_for(bufnr, "textDocument/prepareCallHierarchy")
+  if not client then return cb(nil) end
+  local params = vim.lsp.util.make_position_params(0, client.offset_encoding)
+  client.request("textDocument/prepareCallHierarchy", params, function(err, result)
+    if err or not result or not result[1] then return cb(nil) end
+    client.request("callHierarchy/outgoingCalls", { item = result[1] }, function(err2, calls)
+      if err2 or not calls then return cb(nil) end
+      local locations, items = {}, {}
+      for _, call in ipairs(calls) do
+        local loc = { uri = call.to.uri, range = call.to.selectionRange }
+        table.insert(locations, loc)
+        local item = to_items({ loc }, client.offset_encoding)[1]
+        if item then
+          item.text = call.to.name
+          table.insert(items, item)
+        end
+      end
+      cb(locations, items)
+    end, bufnr)
+  end, bufnr)
+end
+
+local fetchers = { references = fetch_references, outgoing = fetch_outgoing }
+
+local function picker(title)
+  local pickers = require("telescope.pickers")
+  local finders = require("telescope.finders")
+  local make_entry = require("telescope.make_entry")
+  local conf = require("telescope.config").values
+
+  local p = pickers.new({}, {
+    prompt_title = title,
+    finder = finders.new_table({ results = {}, entry_maker = make_entry.gen_from_quickfix() }),
+    previewer = conf.qflist_previewer({}),
+    sorter = conf.generic_sorter({}),
+  })
+  p:find()
+  return function(items)
+    -- pcall, the picker may have been closed in the meantime
+    pcall(p.refresh, p, finders.new_table({ results = items, entry_maker = make_entry.gen_from_quickfix() }),
+      { reset_prompt = false })
+  end
+end
+
+local function lookup(kind, o)
+  local id = index[key(kind, o.uri, o.line, o.col)]
+  return id and entries[id]
+end
+
+local function open(kind, title)
+  local bufnr = vim.api.nvim_get_current_buf()
+  local o = origin()
+  local hit = lookup(kind, o)
+  if hit then
+    picker(title)(hit.items)
+    return
+  end
+
+  local fill = picker(title .. " (waiting on the server)")
+  fetchers[kind](bufnr, function(locations, items)
+    if not locations then return end
+    store(kind, o, locations, items)
+    fill(items)
+  end)
+end
+
+function M.references() open("references", "References") end
+function M.outgoing_calls() open("outgoing", "Outgoing Calls") end
+
+local function prefetch()
+  if not vim.g.neo_mittens_lsp_prefetch then return end
+  local bufnr = vim.api.nvim_get_current_buf()
+  local o = origin()
+  local k = key("references", o.uri, o.line, o.col)
+  if index[k] or inflight[k] then return end
+  inflight[k] = true
+  fetch_references(bufnr, function(locations, items)
+    inflight[k] = nil
+    if locations then store("references", o, locations, items) end
+  end)
+end
+
+local group = vim.api.nvim_create_augroup("NeoMittensLspCache", { clear = true })
+
+vim.api.nvim_create_autocmd({ "TextChanged", "TextChangedI", "BufReadPost", "FileChangedShellPost" }, {
+  group = group,
+  callback = function(args)
+    if next(entries) then invalidate(vim.uri_from_bufnr(args.buf)) end
+  end,
+})
+
+vim.api.nvim_create_autocmd("CursorHold", {
+  group = group,
+  callback = function(args)
+    if vim.bo[args.buf].buftype == "" and client_for(args.buf, "textDocument/references") then prefetch() end
+  end,
+})
+
+return M
@@ -3,19 +3,22 @@ local lsp = require('lsp-zero')
 -- lsp.preset("recommdended")
 lsp.preset({})
 
-lsp.ensure_installed({
-	'lua_ls',
-	'clangd',
-	-- 'tsserver',
-	-- 'eslint',
-	--'sumneko_lua',
-	--'rust_analyzer',
-})
+-- the list lives in install.lua, the headless image install uses it too
+lsp.ensure_installed(require('neo-mittens.install').servers)
 
 local cmp = require('cmp')
 local cmp_action = require('lsp-zero').cmp_action()
 
+-- reuse the last clangd answer while typing the same word, see cmp-cache.lua
+require('neo-mittens.cmp-cache').setup()
+
 cmp.setup({
+	performance = {
+		debounce = 60,         -- ms of quiet typing before asking the sources
+		throttle = 30,         -- ms between refilters of what we already have
+		fetching_timeout = 200, -- don't wait longer than this for a slow source
+		max_view_entries = 100,
+	},
 	sources = {
 		{ name = 'nvim_lsp' },
 		{ name = 'nvim_lua' },
@@ -42,7 +45,11 @@ lsp.setup_nvim_cmp({
 	mapping = cmp_mappings
 })
 
-lsp.on_attach(function(client, bufnr)
+lsp.on_attach(require('neo-mittens.stalls').wrap("lsp on_attach", function(client, bufnr)
+	-- every client attaching to the buffer gets here, the maps only need setting once
+	if vim.b[bufnr].neo_mittens_lsp_maps then return end
+	vim.b[bufnr].neo_mittens_lsp_maps = true
+
 	lsp.default_keymaps({ buffer = bufnr })
 	local opts = { buffer = bufnr, remap = false }
 
@@ -51,7 +58,7 @@ lsp.on_attach(function(client, bufnr)
 		vim.cmd("norm zz")
 	end, opts)
 	vim.keymap.set("n", "K", function() vim.lsp.buf.hover() end, opts)
-	vim.keymap.set("n", "<leader>vws", function() vim.lsp.buf.workspace_symbol() end, opts)
+	vim.keymap.set("n", "<leader>vws", function() require('neo-mittens.symbols').pick() end, opts)
 	vim.keymap.set("n", "<leader>vd", function() vim.diagnostic.open_float() end, opts)
 	vim.keymap.set("n", "<leader>vi", function() vim.lsp.buf.implementation() end, opts)
 	vim.keymap.set("n", "[d", function()
@@ -63,16 +70,27 @@ lsp.on_attach(function(client, bufnr)
 		vim.cmd("norm zz")
 	end, opts)
 	vim.keymap.set("n", "<leader>vca", function() vim.lsp.buf.code_action() end, opts)
-	vim.keymap.set("n", "<leader>vrr", function() vim.lsp.buf.references() end, opts)
+	vim.keymap.set("n", "<leader>vrr", function() require('neo-mittens.lsp-cache').references() end, opts)
 	-- vim.keymap.set("n", "<leader>vrn", function() vim.lsp.buf.rename() end, opts)
 	vim.keymap.set("n", "<F2>", function() vim.lsp.buf.rename() end, opts)
 	vim.keymap.set("i", "<C-h>", function() vim.lsp.buf.signature_help() end, opts)
 
 	--
 	-- - [x] (LSP)   Format source on <A-S-F>
-	vim.keymap.set({ "n", "v" }, "<A-S-f>", ":LspZeroFormat<CR>")
+	-- async, changed lines only, see format.lua
+	vim.keymap.set({ "n", "v" }, "<A-S-f>", function() require('neo-mittens.format').format_mapping() end, opts)
 	--
-end)
+end))
+
+require('neo-mittens.format').setup()
+require('neo-mittens.diagnostics').setup() -- batched publishes, viewport virtual text
+require('neo-mittens.lsp-lifecycle').setup() -- idle shutdown and :NeoMittensLsp
+if vim.g.neo_mittens_lsp_prefetch then
+	require('neo-mittens.lsp-cache') -- otherwise it loads on the first <leader>vrr
+end
+
+-- clangd flags depend on the project, see clangd.lua
+lsp.configure('clangd', require('neo-mittens.clangd').config())
 
 require('lspconfig').lua_ls.setup(lsp.nvim_lua_ls())
 lsp.setup()
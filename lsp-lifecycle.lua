@@ -0,0 +1,101 @@
+-- lsp-lifecycle.lua
+--
+-- Keeps long sessions from piling up language servers. clangd is scoped to
+-- one client per project root (see clangd.root). Here, any client with no
+-- buffers attached for vim.g.neo_mittens_lsp_idle_minutes (10) gets shut
+-- down, so hopping between repos doesn't leave gigabytes of clangd around.
+--
+-- :NeoMittensLsp lists the live clients with their root, buffers and RSS.
+
+local util = require("neo-mittens.util")
+
+local M = {}
+
+local idle_since = {} -- client id -> vim.loop.now() when its last buffer went away
+
+local function idle_ms()
+  return (vim.g.neo_mittens_lsp_idle_minutes or 10) * 60 * 1000
+end
+
+function M.reap()
+  local now = vim.loop.now()
+  for _, client in ipairs(util.lsp_clients()) do
+    if next(client.attached_buffers or {}) then
+      idle_since[client.id] = nil
+    else
+      idle_since[client.id] = idle_since[client.id] or now
+      if now - idle_since[client.id] >= idle_ms() then
+        vim.notify(("lsp: stopping idle %s (%s)"):format(client.name, client.config.root_dir or "?"))
+        client.stop()
+        idle_since[client.id] = nil
+      end
+    end
+  end
+end
+
+-- pid of the server process. 0.9 exposes it on the rpc, otherwise guess by
+-- matching nvim's children against the command name, in start order
+local function pids()
+  local by_client, by_name = {}, {}
+  for _, pid in ipairs(vim.api.nvim_get_proc_children(vim.fn.getpid())) do
+    local proc = vim.api.nvim_get_proc(pid)
+    if proc then
+      by_name[proc.name] = by_name[proc.name] or {}
+      table.insert(by_name[proc.name], pid)
+    end
+  end
+  for _, list in pairs(by_name) do table.sort(list) end
+
+  local clients = util.lsp_clients()
+  table.sort(clients, function(a, b) return a.id < b.id end)
+  for _, client in ipairs(clients) do
+    local pid = client.rpc and client.rpc.pid
+    if not pid then
+      local cmd = client.config.cmd
+      local name = type(cmd) == "table" and vim.fn.fnamemodify(cmd[1], ":t")
+      pid = name and by_name[name] and table.remove(by_name[name], 1)
+    end
+    by_client[client.id] = pid
+  end
+  return by_client
+end
+
+local function rss_mb(pid)
+  local out = vim.fn.system({ "ps", "-o", "rss=", "-p", tostring(pid) })
+  local kb = tonumber(vim.trim(out))
+  return kb and kb / 1024
+end
+
+function M.status()
+  local lines = {}
+  local by_client = pids()
+  for _, client in ipairs(util.lsp_clients()) do
+    local pid = by_client[client.id]
+    local rss = pid and rss_mb(pid)
+    local bufs = vim.tbl_count(client.attached_buffers or {})
+    local idle = idle_since[client.id] and ((vim.loop.now() - idle_since[client.id]) / 60000)
+    table.insert(lines, ("%3d %-10s %8s  %2d bufs%s  %s"):format(
+      client.id, client.name, rss and ("%.0fMB"):format(rss) or "?", bufs,
+      idle and (", idle %.0fm"):format(idle) or "", client.config.root_dir or ""))
+  end
+  if #lines == 0 then lines = { "no lsp clients running" } end
+  vim.notify(table.concat(lines, "\n"))
+end
+
+function M.setup()
+  if M.timer then return end
+  M.timer = vim.loop.new_timer()
+  M.timer:start(60000, 60000, vim.schedule_wrap(M.reap))
+
+  vim.api.nvim_create_user_command("NeoMittensLsp", M.status, {})
+end
+
+-- :NeoMittensReload, the reloaded module starts its own timer
+function M.teardown()
+  if not M.timer then return end
+  M.timer:stop()
+  M.timer:close()
+  M.timer = nil
+end
+
+return M
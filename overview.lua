@@ -0,0 +1,178 @@
+-- overview.lua
+--
+-- The one scroll indicator / overview. There used to be both mini.map and
+-- nvim-scrollview, each with its own window, autocmds and redraws on every
+-- <C-d>zz. Now there's a single backend picked with
+--
+--   vim.g.neo_mittens_overview = "scrollview" (default) | "minimap" | "none"
+--
+-- and lazy only loads that one. The default stays the light scrollview bar
+-- that was always on. Whichever backend, it's open by default,
+-- vim.g.neo_mittens_overview_open = false starts it closed, and <leader>tm
+-- toggles.
+--
+-- With mini.map, all of its refreshes go through one debounced path here.
+-- Content refreshes are debounced (vim.g.neo_mittens_minimap_debounce,
+-- 300ms), and past vim.g.neo_mittens_minimap_sample_lines (5000) lines they
+-- only happen on CursorHold and save. Long buffers are encoded from an
+-- evenly sampled subset of lines. Scrolling only updates the scrollbar.
+-- Diagnostics, git hunks and search hits come from the integrations and
+-- never rescan the buffer. Big-file and terminal buffers get no overview.
+
+local bigfile = require("neo-mittens.bigfile")
+
+local M = {}
+
+M.backend = vim.g.neo_mittens_overview or "scrollview"
+M.wanted = vim.g.neo_mittens_overview_open ~= false -- big files close it regardless
+
+local group = vim.api.nvim_create_augroup("NeoMittensOverview", { clear = true })
+
+local function setup_scrollview()
+  require("scrollview").setup({
+    excluded_filetypes = { "TelescopePrompt", "lazy", "mason", "minimap" },
+    excluded_buftypes = { "terminal" },
+    current_only = true,
+    signs_on_startup = { "diagnostics", "search", "conflicts" },
+  })
+  pcall(function() require("scrollview.contrib.gitsigns").setup() end)
+  if not M.wanted then vim.cmd("ScrollViewDisable") end
+
+  function M.toggle()
+    M.wanted = not M.wanted
+    vim.cmd(M.wanted and "ScrollViewEnable" or "ScrollViewDisable")
+  end
+end
+
+local function setup_minimap()
+  local map = require("mini.map")
+  local debounce = vim.g.neo_mittens_minimap_debounce or 300
+  local sample_lines = vim.g.neo_mittens_minimap_sample_lines or 5000
+
+  map.setup({
+    integrations = {
+      map.gen_integration.builtin_search(),
+      map.gen_integration.gitsigns(),
+      map.gen_integration.diagnostic(),
+    },
+    symbols = { encode = map.gen_encode_symbols.dot("4x2") },
+    window = { focusable = false, side = "right", width = 10, winblend = 25 },
+  })
+
+  -- sample long buffers before they get encoded. util.wrap, so a reload
+  -- doesn't sample an already sampled list again
+  if type(MiniMap.encode_strings) == "function" then
+    require("neo-mittens.util").wrap(MiniMap, "encode_strings", function(encode_strings)
+      return function(strings, opts)
+        if #strings > sample_lines then
+          local sampled, step = {}, #strings / sample_lines
+          for i = 1, sample_lines do
+            sampled[i] = strings[math.floor((i - 1) * step) + 1]
+          end
+          strings = sampled
+        end
+        return encode_strings(strings, opts)
+      end
+    end)
+  end
+
+  -- we drive the edit and scroll refreshes ourselves
+  pcall(vim.api.nvim_clear_autocmds, {
+    group = "MiniMap",
+    event = { "TextChanged", "TextChangedI", "CursorMoved", "WinScrolled" },
+  })
+
+  local function is_open()
+    local ok, win = pcall(function() return MiniMap.current.win_data[vim.api.nvim_get_current_tabpage()] end)
+    return ok and win ~= nil and vim.api.nvim_win_is_valid(win)
+  end
+
+  -- the single refresh path, parts pile up until the timer fires
+  local timer = vim.loop.new_timer()
+  M.timer = timer
+  local parts = {}
+  local function flush()
+    local todo = parts
+    parts = {}
+    if not is_open() or bigfile.is_big(0) then return end
+    MiniMap.refresh({}, {
+      integrations = todo.integrations or false,
+      lines = todo.lines or false,
+      scrollbar = todo.scrollbar or false,
+    })
+  end
+  function M.schedule(want, delay)
+    if not is_open() then return end
+    for k, v in pairs(want) do parts[k] = parts[k] or v end
+    timer:stop()
+    timer:start(delay, 0, vim.schedule_wrap(flush))
+  end
+
+  local all = { integrations = true, lines = true, scrollbar = true }
+  local scroll_debounce = vim.g.neo_mittens_overview_scroll_debounce or 30
+
+  vim.api.nvim_create_autocmd({ "TextChanged", "TextChangedI" }, {
+    group = group,
+    callback = function(args)
+      if vim.api.nvim_buf_line_count(args.buf) <= sample_lines then M.schedule(all, debounce) end
+    end,
+  })
+  vim.api.nvim_create_autocmd("CursorHold", {
+    group = group,
+    callback = function(args)
+      if vim.api.nvim_buf_line_count(args.buf) > sample_lines then M.schedule(all, 0) end
+    end,
+  })
+  vim.api.nvim_create_autocmd({ "CursorMoved", "WinScrolled" }, {
+    group = group,
+    callback = function() M.schedule({ scrollbar = true }, scroll_debounce) end,
+  })
+  vim.api.nvim_create_autocmd("DiagnosticChanged", {
+    group = group,
+    callback = function() M.schedule({ integrations = true }, debounce) end,
+  })
+  vim.api.nvim_create_autocmd("User", {
+    group = group,
+    pattern = "GitSignsUpdate",
+    callback = function() M.schedule({ integrations = true }, debounce) end,
+  })
+
+  local function sync(buf)
+    if bigfile.is_big(buf) or vim.b[buf].minimap_disable or vim.bo[buf].buftype == "terminal" then
+      if is_open() then MiniMap.close() end
+    elseif M.wanted and not is_open() and vim.bo[buf].buftype == "" then
+      MiniMap.open()
+    end
+  end
+  vim.api.nvim_create_autocmd("BufEnter", {
+    group = group,
+    callback = function(args) sync(args.buf) end,
+  })
+  vim.schedule(function() sync(vim.api.nvim_get_current_buf()) end)
+
+  function M.toggle()
+    M.wanted = not M.wanted
+    if M.wanted and not bigfile.is_big(0) then
+      MiniMap.open()
+    else
+      MiniMap.close()
+    end
+  end
+end
+
+if M.backend == "scrollview" then
+  setup_scrollview()
+elseif M.backend == "minimap" then
+  setup_minimap()
+end
+
+M.toggle = M.toggle or function() end
+
+function M.teardown()
+  if not M.timer then return end
+  M.timer:stop()
+  M.timer:close()
+  M.timer = nil
+end
+
+return M
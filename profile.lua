@@ -0,0 +1,179 @@
+-- profile.lua
+--
+-- Startup profiling, so changes to lazy.lua and the setup modules can be
+-- checked against a number instead of a feeling.
+--
+-- Spawns `nvim --headless --startuptime` a few times, then reports the
+-- neo-mittens module times, the plugins lazy loaded at startup and the
+-- median total.
+--
+--   :NeoMittensProfile [runs] [budget_ms]
+--   nvim --headless -c 'lua require("neo-mittens.profile").cli()'
+--
+-- The cli exits non-zero when the median total blows the budget, which is
+-- `vim.g.neo_mittens_startup_budget_ms` (or $NEO_MITTENS_STARTUP_BUDGET),
+-- 60ms by default.
+
+local M = {}
+
+local function opt(env, global, default)
+  return tonumber(vim.env[env]) or vim.g[global] or default
+end
+
+local function median(xs)
+  if #xs == 0 then return 0 end
+  local s = vim.deepcopy(xs)
+  table.sort(s)
+  local mid = math.floor(#s / 2)
+  if #s % 2 == 1 then return s[mid + 1] end
+  return (s[mid] + s[mid + 1]) / 2
+end
+
+-- Called inside the child right before it quits, dumps what lazy loaded
+function M.dump_plugins(path)
+  local out = {}
+  local ok, config = pcall(require, "lazy.core.config")
+  if ok then
+    for name, plugin in pairs(config.plugins) do
+      local loaded = plugin._ and plugin._.loaded
+      if loaded and loaded.time then
+        out[name] = loaded.time / 1e6 -- lazy keeps these in ns
+      end
+    end
+  end
+  local f = io.open(path, "w")
+  if f then
+    f:write(vim.json.encode(out))
+    f:close()
+  end
+end
+
+local function parse_startuptime(path)
+  local run = { modules = {}, total = nil }
+  local f = io.open(path, "r")
+  if not f then return nil end
+  for line in f:lines() do
+    -- clock  self+sourced  self: require('mod')
+    local _, sourced, mod = line:match("^(%d+%.%d+)%s+(%d+%.%d+)%s+%d+%.%d+:%s+require%('([^']+)'%)")
+    if mod then
+      run.modules[mod] = (run.modules[mod] or 0) + tonumber(sourced)
+    end
+    local clock = line:match("^(%d+%.%d+)%s+%d+%.%d+:%s+%-%-%- NVIM STARTED %-%-%-")
+    if clock then run.total = tonumber(clock) end
+  end
+  f:close()
+  return run
+end
+
+local function read_json(path)
+  local f = io.open(path, "r")
+  if not f then return {} end
+  local data = f:read("*a")
+  f:close()
+  local ok, decoded = pcall(vim.json.decode, data)
+  return ok and decoded or {}
+end
+
+local function one_run()
+  local times = vim.fn.tempname()
+  local plugins = vim.fn.tempname()
+  -- quit from after VimEnter, so startup (and the --- NVIM STARTED --- line)
+  -- is done and the VeryLazy plugins got loaded too. -c / + commands would
+  -- run before that.
+  local quit = ("autocmd VimEnter * ++once lua vim.defer_fn(function()"
+    .. " require('neo-mittens.profile').dump_plugins(%s); vim.cmd('qa!') end, 50)"):format(vim.inspect(plugins))
+  vim.fn.system({ vim.v.progpath, "--headless", "--startuptime", times, "--cmd", quit })
+  local run = parse_startuptime(times)
+  if run then run.plugins = read_json(plugins) end
+  os.remove(times)
+  os.remove(plugins)
+  return run
+end
+
+-- Returns { total = median_ms, totals = {...}, modules = {name = median_ms}, plugins = {...} }
+function M.run(opts)
+  opts = opts or {}
+  local runs = opts.runs or opt("NEO_MITTENS_PROFILE_RUNS", "neo_mittens_profile_runs", 10)
+
+  local totals, modules, plugins = {}, {}, {}
+  for _ = 1, runs do
+    local run = one_run()
+    if run and run.total then
+      table.insert(totals, run.total)
+      for mod, t in pairs(run.modules) do
+        modules[mod] = modules[mod] or {}
+        table.insert(modules[mod], t)
+      end
+      for name, t in pairs(run.plugins) do
+        plugins[name] = plugins[name] or {}
+        table.insert(plugins[name], t)
+      end
+    end
+  end
+
+  local result = { total = median(totals), totals = totals, modules = {}, plugins = {} }
+  for mod, ts in pairs(modules) do result.modules[mod] = median(ts) end
+  for name, ts in pairs(plugins) do result.plugins[name] = median(ts) end
+  return result
+end
+
+local function sorted(tbl, filter)
+  local out = {}
+  for k, v in pairs(tbl) do
+    if not filter or filter(k) then table.insert(out, { k, v }) end
+  end
+  table.sort(out, function(a, b) return a[2] > b[2] end)
+  return out
+end
+
+function M.report(result, budget)
+  local lines = {}
+  if #result.totals == 0 then
+    -- nothing to measure is a failure, not a pass
+    return { "startup: no run got to --- NVIM STARTED ---, is the config broken?" }, true
+  end
+  local over = result.total > budget
+  table.insert(lines, ("startup: %.2fms median over %d runs (budget %dms)%s"):format(
+    result.total, #result.totals, budget, over and "  ** OVER BUDGET **" or ""))
+
+  table.insert(lines, "")
+  table.insert(lines, "neo-mittens modules (self+sourced):")
+  for _, e in ipairs(sorted(result.modules, function(m) return m:find("^neo%-mittens") end)) do
+    table.insert(lines, ("  %8.2fms  %s"):format(e[2], e[1]))
+  end
+
+  table.insert(lines, "")
+  table.insert(lines, "plugins loaded at startup:")
+  for _, e in ipairs(sorted(result.plugins)) do
+    table.insert(lines, ("  %8.2fms  %s"):format(e[2], e[1]))
+  end
+  return lines, over
+end
+
+-- :NeoMittensProfile [runs] [budget_ms]
+function M.command(args)
+  local runs, budget = unpack(vim.tbl_map(tonumber, args.fargs or {}))
+  budget = budget or opt("NEO_MITTENS_STARTUP_BUDGET", "neo_mittens_startup_budget_ms", 60)
+  vim.notify("profiling startup...")
+  local lines, over = M.report(M.run({ runs = runs }), budget)
+
+  vim.cmd("botright new")
+  local buf = vim.api.nvim_get_current_buf()
+  vim.bo[buf].buftype = "nofile"
+  vim.bo[buf].bufhidden = "wipe"
+  vim.api.nvim_buf_set_lines(buf, 0, -1, false, lines)
+  vim.bo[buf].modifiable = false
+  if over then
+    vim.notify(lines[1], vim.log.levels.WARN)
+  end
+end
+
+-- headless entry point, exits 1 when over budget or when no run finished
+function M.cli()
+  local budget = opt("NEO_MITTENS_STARTUP_BUDGET", "neo_mittens_startup_budget_ms", 60)
+  local lines, over = M.report(M.run(), budget)
+  io.stdout:write(table.concat(lines, "\n") .. "\n")
+  vim.cmd(over and "cquit 1" or "qall!")
+end
+
+return M
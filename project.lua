@@ -0,0 +1,55 @@
+-- project.lua
+--
+-- Per-project overrides from a `.neo-mittens.lua` at (or above) the project
+-- root. The file just returns a table, e.g.
+--
+--   return { clangd = { profile = "laptop" } }
+--
+-- It's read through vim.secure.read, so a new or changed file needs a
+-- `:trust` before anything in it gets run.
+
+local M = {}
+
+M.marker = ".neo-mittens.lua"
+
+local cache = {}
+
+local function find(path)
+  return vim.fs.find(M.marker, { upward = true, path = path, type = "file" })[1]
+end
+
+-- Directory holding the nearest .neo-mittens.lua, or nil
+function M.root(path)
+  local file = find(path)
+  return file and vim.fs.dirname(file)
+end
+
+-- The project table for `path` (a file or directory), {} when there's none
+function M.config(path)
+  local file = find(path or vim.loop.cwd())
+  if not file then return {} end
+  if cache[file] then return cache[file] end
+
+  local conf = {}
+  local src = vim.secure and vim.secure.read(file) -- nil until trusted
+  if src then
+    local chunk, err = load(src, "@" .. file)
+    local ok, res = false, err
+    if chunk then ok, res = pcall(chunk) end
+    if ok and type(res) == "table" then
+      conf = res
+    else
+      vim.notify(("neo-mittens: bad %s: %s"):format(file, tostring(res)), vim.log.levels.WARN)
+    end
+  end
+  cache[file] = conf
+  return conf
+end
+
+vim.api.nvim_create_autocmd("BufWritePost", {
+  group = vim.api.nvim_create_augroup("NeoMittensProject", { clear = true }),
+  pattern = M.marker,
+  callback = function(args) cache[vim.fn.fnamemodify(args.file, ":p")] = nil end,
+})
+
+return M
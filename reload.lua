@@ -0,0 +1,74 @@
+-- reload.lua
+--
+-- <leader>s used to be `:w | so %`, which re-ran the whole file on top of
+-- what it registered last time. Now it reloads the neo-mittens module the
+-- buffer is: the old one gets its teardown() if it has one, is dropped from
+-- package.loaded and required again, and a setup() it exposes
+-- is called again. Every module puts its autocmds in a cleared augroup and
+-- wraps through util.wrap, so nothing stacks no matter how often you reload.
+--
+-- :NeoMittensReload [module] does the same for any loaded module (the
+-- current buffer's by default), outside this repo it falls back to :source.
+
+local M = {}
+
+local dir = vim.fn.fnamemodify(debug.getinfo(1, "S").source:sub(2), ":p:h")
+
+-- these only make sense once per session
+local pinned = {
+  ["neo-mittens.lazy"] = "lazy.nvim can't be set up twice, restart nvim",
+  ["neo-mittens.lazy-bootstrap"] = "restart nvim",
+  ["neo-mittens.lsp-config"] = "lspconfig would register every server again, restart nvim (or :LspRestart)",
+  ["neo-mittens.init"] = "restart nvim",
+  ["neo-mittens.stalls"] = "it patches nvim_create_autocmd, restart nvim",
+}
+
+-- "neo-mittens.<name>" for a file of this repo, nil otherwise
+function M.module_of(path)
+  path = vim.fn.fnamemodify(path, ":p")
+  if vim.fn.fnamemodify(path, ":h") ~= dir or vim.fn.fnamemodify(path, ":e") ~= "lua" then return nil end
+  return "neo-mittens." .. vim.fn.fnamemodify(path, ":t:r")
+end
+
+function M.reload(name)
+  if pinned[name] then
+    return vim.notify(("reload: %s, %s"):format(name, pinned[name]), vim.log.levels.WARN)
+  end
+
+  local old = package.loaded[name]
+  if type(old) == "table" and type(old.teardown) == "function" then pcall(old.teardown) end
+  package.loaded[name] = nil
+
+  local ok, mod = pcall(require, name)
+  if ok and type(mod) == "table" and type(mod.setup) == "function" then
+    ok, mod = pcall(mod.setup)
+  end
+  if not ok then
+    return vim.notify(("reload: %s failed\n%s"):format(name, mod), vim.log.levels.ERROR)
+  end
+  vim.notify("reload: " .. name)
+end
+
+-- <leader>s, write and reload the current buffer
+function M.current()
+  if vim.bo.modified then vim.cmd.write() end
+  local name = M.module_of(vim.api.nvim_buf_get_name(0))
+  if name then return M.reload(name) end
+  vim.cmd.source("%")
+end
+
+function M.command(args)
+  if args.args == "" then return M.current() end
+  M.reload(args.args:find("^neo%-mittens%.") and args.args or "neo-mittens." .. args.args)
+end
+
+function M.complete()
+  local names = {}
+  for name in pairs(package.loaded) do
+    if name:find("^neo%-mittens%.") and not pinned[name] then table.insert(names, name:sub(#"neo-mittens." + 1)) end
+  end
+  table.sort(names)
+  return names
+end
+
+return M
@@ -19,6 +19,14 @@ if not vim.g.vscode then
   vim.api.nvim_create_user_command("CopyRelPath", "call setreg('+', expand('%'))", {})
   vim.keymap.set("n", "<leader>fy", ":CopyRelPath<CR>")
 
+  -- Tooling, see profile.lua and ts-bootstrap.lua
+  vim.api.nvim_create_user_command("NeoMittensProfile", function(args)
+    require("neo-mittens.profile").command(args)
+  end, { nargs = "*" })
+  vim.api.nvim_create_user_command("NeoMittensTSBootstrap", function()
+    require("neo-mittens.ts-bootstrap").command()
+  end, {})
+
   vim.o.colorcolumn = "80,120"
   vim.o.cursorline = true
   vim.o.relativenumber = true
@@ -43,12 +51,13 @@ vim.o.wrap = false
 
 vim.keymap.set({ 'n', 'v' }, "<leader>y", "\"+y")
 vim.keymap.set({ 'n', 'v' }, "<leader>p", "\"+p")
-vim.keymap.set("n", "<leader>s", ":w<CR>:so %<CR>")
+-- write and reload the neo-mittens module (or :so anything else), see reload.lua
+vim.keymap.set("n", "<leader>s", function() require("neo-mittens.reload").current() end)
+vim.api.nvim_create_user_command("NeoMittensReload", function(args)
+  require("neo-mittens.reload").command(args)
+end, { nargs = "?", complete = function() return require("neo-mittens.reload").complete() end })
 vim.keymap.set("", "<leader>w", ":w<CR>")
 vim.keymap.set("", "<leader>x", ":x<CR>")
 
-
--- This makes shit transparent so i can see the waifu's in the background
--- :hi normal guibg=NONE
-vim.cmd.highlight({ "normal", "guibg=NONE" })
-vim.cmd.highlight({ "SignColumn", "guibg=NONE" }) -- or you can also set it to darkgrey, for now tho.... its pretty good like this.
+-- The transparent Normal / SignColumn (so i can see the waifu's in the
+-- background) is compiled in with gruvbox now, see highlights.lua
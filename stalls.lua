@@ -0,0 +1,168 @@
+-- stalls.lua
+--
+-- Finds what makes the editor hitch. Opt-in, it costs a couple of hrtime
+-- calls per callback:
+--
+--   vim.g.neo_mittens_stalls = true   (before init.lua gets to it)
+--   NEO_MITTENS_STALLS=1 nvim
+--
+-- Every autocmd callback (ours and the plugins', which is why init.lua
+-- loads this first), every vim.lsp.handlers entry and whatever goes through
+-- M.wrap (the on_attach functions) gets timed under a label like
+-- "BufEnter NeoMittensOverview (overview)". A libuv timer ticks every
+-- 50ms; when a tick comes in later than vim.g.neo_mittens_stall_ms (100),
+-- the main loop was stuck and the slowest callback since the last tick
+-- gets the stall.
+--
+-- :NeoMittensStalls lists the worst offenders (stalls, calls, total, max)
+-- plus what lazy spent loading each plugin. :NeoMittensStalls reset starts
+-- over.
+
+local M = {}
+
+local hrtime = vim.loop.hrtime
+local tick_ms = 50
+
+local stats = {}       -- label -> { calls, total, max, stalls, worst_stall }
+local groups = {}      -- augroup id -> name
+local handlers = setmetatable({}, { __mode = "k" }) -- our lsp handler wrappers
+local slowest          -- { label, ms } since the last tick
+local unattributed = { calls = 0, total = 0, max = 0, stalls = 0, worst_stall = 0 }
+
+local function record(label, ms)
+  local s = stats[label]
+  if not s then
+    s = { calls = 0, total = 0, max = 0, stalls = 0, worst_stall = 0 }
+    stats[label] = s
+  end
+  s.calls = s.calls + 1
+  s.total = s.total + ms
+  if ms > s.max then s.max = ms end
+  if not slowest or ms > slowest[2] then slowest = { label, ms } end
+end
+
+local function finish(label, start, ...)
+  record(label, (hrtime() - start) / 1e6)
+  return ...
+end
+
+-- fn timed under `label`. Returns fn untouched when stalls are off, so
+-- callers can use it unconditionally.
+function M.wrap(label, fn)
+  if not M.running or type(fn) ~= "function" then return fn end
+  return function(...) return finish(label, hrtime(), fn(...)) end
+end
+
+-- plugin or neo-mittens module name of the code that called us
+local function caller()
+  local src = debug.getinfo(3, "S").source or ""
+  return src:match("/lazy/([^/]+)/") or src:match("([^/]+)%.lua$") or src
+end
+
+local function patch_autocmds()
+  local create_augroup = vim.api.nvim_create_augroup
+  vim.api.nvim_create_augroup = function(name, opts)
+    local id = create_augroup(name, opts)
+    groups[id] = name
+    return id
+  end
+
+  local create_autocmd = vim.api.nvim_create_autocmd
+  vim.api.nvim_create_autocmd = function(event, opts)
+    if opts and type(opts.callback) == "function" then
+      local group = type(opts.group) == "number" and groups[opts.group] or opts.group
+      local label = ("%s %s(%s)"):format(
+        type(event) == "table" and table.concat(event, ",") or event,
+        group and (group .. " ") or "",
+        caller())
+      opts = vim.tbl_extend("force", opts, { callback = M.wrap(label, opts.callback) })
+    end
+    return create_autocmd(event, opts)
+  end
+end
+
+-- handlers get replaced by plugins all the time, so this runs on every attach
+local function patch_handlers()
+  for method, fn in pairs(vim.lsp.handlers) do
+    if type(fn) == "function" and not handlers[fn] then
+      local wrapped = M.wrap("lsp " .. method, fn)
+      handlers[wrapped] = true
+      vim.lsp.handlers[method] = wrapped
+    end
+  end
+end
+
+local function tick(expected)
+  local now = hrtime()
+  local late = (now - expected) / 1e6
+  if late > (vim.g.neo_mittens_stall_ms or 100) then
+    local s = slowest and stats[slowest[1]] or unattributed
+    s.stalls = s.stalls + 1
+    if late > s.worst_stall then s.worst_stall = late end
+  end
+  slowest = nil
+  return now + tick_ms * 1e6
+end
+
+function M.start()
+  if M.running then return end
+  M.running = true
+  patch_autocmds()
+
+  local expected = hrtime() + tick_ms * 1e6
+  M.timer = vim.loop.new_timer()
+  M.timer:start(tick_ms, tick_ms, function() expected = tick(expected) end)
+
+  vim.api.nvim_create_autocmd("LspAttach", {
+    group = vim.api.nvim_create_augroup("NeoMittensStalls", { clear = true }),
+    callback = patch_handlers,
+  })
+  vim.api.nvim_create_user_command("NeoMittensStalls", function(args)
+    if args.args == "reset" then return M.reset() end
+    M.report()
+  end, { nargs = "?", complete = function() return { "reset" } end })
+end
+
+function M.reset()
+  stats = {}
+  slowest = nil
+  unattributed = { calls = 0, total = 0, max = 0, stalls = 0, worst_stall = 0 }
+end
+
+function M.report(limit)
+  limit = limit or 25
+  local rows = {}
+  for label, s in pairs(stats) do table.insert(rows, { label, s }) end
+  if unattributed.stalls > 0 then table.insert(rows, { "(nothing timed, timers / vim.schedule)", unattributed }) end
+  table.sort(rows, function(a, b)
+    if a[2].stalls ~= b[2].stalls then return a[2].stalls > b[2].stalls end
+    return a[2].max > b[2].max
+  end)
+
+  local lines = { ("%6s %7s %9s %8s %8s  %s"):format("stalls", "calls", "total", "max", "worst", "label") }
+  for i = 1, math.min(limit, #rows) do
+    local label, s = rows[i][1], rows[i][2]
+    table.insert(lines, ("%6d %7d %7.1fms %6.1fms %6.1fms  %s"):format(
+      s.stalls, s.calls, s.total, s.max, s.worst_stall, label))
+  end
+
+  -- what lazy spent loading (and setting up) each plugin
+  local ok, config = pcall(require, "lazy.core.config")
+  if ok then
+    local loads = {}
+    for name, plugin in pairs(config.plugins) do
+      local loaded = plugin._ and plugin._.loaded
+      if loaded and loaded.time then table.insert(loads, { name, loaded.time / 1e6 }) end
+    end
+    table.sort(loads, function(a, b) return a[2] > b[2] end)
+    table.insert(lines, "")
+    table.insert(lines, "plugin loads:")
+    for i = 1, math.min(10, #loads) do
+      table.insert(lines, ("%8.1fms  %s"):format(loads[i][2], loads[i][1]))
+    end
+  end
+
+  vim.notify(table.concat(lines, "\n"))
+end
+
+return M
@@ -0,0 +1,213 @@
+-- symbols.lua
+--
+-- Workspace symbols (<leader>fws, <leader>vws) from a local on-disk index
+-- instead of a clangd round trip per keystroke, so lookup stays fast while
+-- clangd is busy indexing.
+--
+-- The index is a universal-ctags tags file per git root under
+-- stdpath("cache")/neo-mittens/symbols. The first build tags `git ls-files`.
+-- After that only what git says changed since the indexed HEAD (plus dirty
+-- and untracked files) gets re-tagged, when the picker opens, and on save
+-- for the written file. Filtering goes through the generic sorter, which is
+-- the native fzf one (telescope.lua). Without ctags on $PATH we fall back to
+-- the lsp picker.
+
+local util = require("neo-mittens.util")
+
+local M = {}
+
+local cache_dir = vim.fn.stdpath("cache") .. "/neo-mittens/symbols"
+local ctags_args = { "--fields=+nK", "--extras=-F", "--sort=no", "--output-format=u-ctags" }
+
+local running = {}
+
+function M.root(path)
+  local git = vim.fs.find(".git", { upward = true, path = path or vim.loop.cwd() })[1]
+  return git and vim.fs.dirname(git)
+end
+
+local function paths(root)
+  local name = root:gsub("[/\\:]", "%%")
+  return cache_dir .. "/" .. name .. ".tags", cache_dir .. "/" .. name .. ".json"
+end
+
+local function read_meta(file)
+  local f = io.open(file, "r")
+  if not f then return {} end
+  local ok, meta = pcall(vim.json.decode, f:read("*a"))
+  f:close()
+  return ok and meta or {}
+end
+
+local function write_meta(file, meta)
+  vim.fn.writefile({ vim.json.encode(meta) }, file)
+end
+
+local function full_build(root, tags, meta_file, head, done)
+  local tmp = tags .. ".tmp"
+  local cmd = { "sh", "-c", 'git ls-files | ctags -L - -f "$@"', "sh", tmp }
+  vim.list_extend(cmd, ctags_args)
+  util.job(cmd, { cwd = root }, function(code)
+    if code == 0 then
+      os.rename(tmp, tags)
+      write_meta(meta_file, { head = head })
+    end
+    done(code == 0)
+  end)
+end
+
+-- Drops every tag for `files` and appends fresh ones, all in a job so a
+-- big tags file never gets read into the main loop. done(ok)
+local function retag(root, tags, files, done)
+  local existing = vim.tbl_filter(function(f) return vim.loop.fs_stat(root .. "/" .. f) ~= nil end, files)
+  local list = vim.fn.tempname()
+  vim.fn.writefile(files, list)
+  -- awk drops the lines whose file column is in the list; ctags then
+  -- appends the new tags for whatever still exists
+  local script = [[
+    tags="$1" list="$2"; shift 2
+    awk -F '\t' 'NR == FNR { drop[$0] = 1; next } !($2 in drop)' "$list" "$tags" > "$tags.tmp" || exit 1
+    if [ "$#" -gt 0 ]; then ctags --append=yes -f "$tags.tmp" "$@" || exit 1; fi
+    mv "$tags.tmp" "$tags"
+  ]]
+  local cmd = { "sh", "-c", script, "sh", tags, list }
+  if #existing > 0 then
+    vim.list_extend(cmd, ctags_args)
+    vim.list_extend(cmd, existing)
+  end
+  util.job(cmd, { cwd = root }, function(code)
+    os.remove(list)
+    done(code == 0)
+  end)
+end
+
+-- Takes the per-root lock, fn(finish) runs with it held; false when a run
+-- for that root is already going
+local function locked(root, fn, done)
+  if running[root] then
+    done(false)
+    return false
+  end
+  running[root] = true
+  fn(function(ok)
+    running[root] = nil
+    done(ok)
+  end)
+  return true
+end
+
+local function update(root, finish)
+  vim.fn.mkdir(cache_dir, "p")
+  local tags, meta_file = paths(root)
+  local meta = read_meta(meta_file)
+
+  util.job({ "git", "rev-parse", "HEAD" }, { cwd = root }, function(code, out)
+    local head = code == 0 and out[1] or nil
+    if not meta.head or not vim.loop.fs_stat(tags) then
+      return full_build(root, tags, meta_file, head, finish)
+    end
+
+    -- separate jobs, a failed diff (old head gone after a gc) must not hide
+    -- behind ls-files succeeding
+    util.job({ "git", "diff", "--name-only", meta.head, "HEAD" }, { cwd = root }, function(code2, diffed)
+      if code2 ~= 0 then return full_build(root, tags, meta_file, head, finish) end
+      util.job({ "git", "ls-files", "-mo", "--exclude-standard" }, { cwd = root }, function(code3, dirty_files)
+        if code3 ~= 0 then return finish(false) end
+        local changed = vim.list_extend(diffed, dirty_files)
+        if #changed == 0 then return finish(true) end
+        retag(root, tags, changed, function(ok)
+          if ok then write_meta(meta_file, { head = head }) end
+          finish(ok)
+        end)
+      end)
+    end)
+  end)
+end
+
+-- Brings the index for `root` up to date, done(ok) when finished
+function M.update(root, done)
+  locked(root, function(finish) update(root, finish) end, done or function() end)
+end
+
+local function entry_maker(root)
+  return function(line)
+    if line:sub(1, 2) == "!_" then return nil end
+    local name, file, rest = line:match("^([^\t]+)\t([^\t]+)\t(.*)$")
+    if not name then return nil end
+    local kind = rest:match('\tkind:(%w+)') or rest:match(';"\t(%w+)') or ""
+    local lnum = tonumber(rest:match("\tline:(%d+)")) or 1
+    return {
+      value = line,
+      ordinal = name,
+      display = ("%-40s %-10s %s:%d"):format(name, kind, file, lnum),
+      filename = root .. "/" .. file,
+      lnum = lnum,
+      col = 1,
+    }
+  end
+end
+
+function M.pick(opts)
+  opts = opts or {}
+  local root = M.root()
+  if vim.fn.executable("ctags") ~= 1 or not root then
+    return require("telescope.builtin").lsp_dynamic_workspace_symbols(opts)
+  end
+
+  local tags = paths(root)
+  local function open()
+    local pickers = require("telescope.pickers")
+    local finders = require("telescope.finders")
+    local conf = require("telescope.config").values
+    pickers.new(opts, {
+      prompt_title = "Workspace Symbols (index)",
+      finder = finders.new_oneshot_job({ "cat", tags }, { entry_maker = entry_maker(root) }),
+      previewer = conf.grep_previewer(opts),
+      sorter = conf.generic_sorter(opts),
+    }):find()
+  end
+
+  if vim.loop.fs_stat(tags) then
+    open()
+    M.update(root) -- catch up in the background, next open sees it
+  else
+    vim.notify("symbols: building the index for " .. root)
+    M.update(root, function(ok) if ok then open() end end)
+  end
+end
+
+local timer = vim.loop.new_timer()
+local dirty = {}
+
+-- retags the saved files, same lock as M.update; while that's running
+-- they stay dirty and get another go in a second
+local function flush()
+  for root, files in pairs(dirty) do
+    local took = locked(root, function(finish)
+      retag(root, paths(root), vim.tbl_keys(files), finish)
+    end, function() end)
+    if took then dirty[root] = nil end
+  end
+  if next(dirty) and not timer:is_closing() then timer:start(1000, 0, vim.schedule_wrap(flush)) end
+end
+
+vim.api.nvim_create_autocmd("BufWritePost", {
+  group = vim.api.nvim_create_augroup("NeoMittensSymbols", { clear = true }),
+  callback = function(args)
+    local root = M.root(vim.fs.dirname(args.file))
+    local tags = root and paths(root)
+    if not (tags and vim.loop.fs_stat(tags)) then return end
+    local file = vim.fn.fnamemodify(args.file, ":p"):sub(#root + 2)
+    dirty[root] = dirty[root] or {}
+    dirty[root][file] = true
+    timer:stop()
+    timer:start(1000, 0, vim.schedule_wrap(flush))
+  end,
+})
+
+function M.teardown()
+  timer:stop()
+  timer:close()
+end
+
+return M
@@ -1,7 +1,153 @@
+local util = require('neo-mittens.util')
+local telescope = require('telescope')
 local builtin = require('telescope.builtin')
-vim.keymap.set('n', '<leader>ff', function() builtin.find_files() end, {})
-vim.keymap.set('n', '<leader>ffh', function() builtin.find_files({hidden = true}) end, {})
-vim.keymap.set('n', '<leader>fg', function() builtin.live_grep() end, {})
+
+-- build outputs and deps, nobody wants to fuzzy find through these
+local ignore = { ".git", "build", "_build", "out", "target", "node_modules", ".cache", "bazel-*" }
+local threads = tostring(vim.g.neo_mittens_search_threads or util.cpu_count())
+local fd = util.executable({ "fd", "fdfind" }) -- debian calls it fdfind
+
+local function find_command(hidden)
+  local cmd
+  if fd then
+    cmd = { fd, "--type", "f", "--color", "never", "--threads", threads }
+    if hidden then table.insert(cmd, "--hidden") end
+    for _, dir in ipairs(ignore) do vim.list_extend(cmd, { "--exclude", dir }) end
+  else
+    cmd = { "rg", "--files", "--color", "never", "--threads", threads }
+    if hidden then table.insert(cmd, "--hidden") end
+    for _, dir in ipairs(ignore) do vim.list_extend(cmd, { "--glob", "!" .. dir }) end
+  end
+  return cmd
+end
+
+local vimgrep_arguments = {
+  "rg", "--color=never", "--no-heading", "--with-filename", "--line-number",
+  "--column", "--smart-case", "--threads", threads,
+}
+for _, dir in ipairs(ignore) do
+  vim.list_extend(vimgrep_arguments, { "--glob", "!" .. dir })
+end
+
+-- Previews. Moving the selection over big generated files used to read them
+-- whole and run treesitter on them. Now small files get treesitter, bigger
+-- ones regex syntax, past highlight_limit nothing, and past filesize_limit
+-- no preview at all. Binaries are spotted from their first KB (read async)
+-- instead of spawning `file` for every entry.
+local ts_preview_limit = (vim.g.neo_mittens_preview_ts_kb or 256) * 1024
+local preview = {
+  filesize_limit = vim.g.neo_mittens_preview_max_mb or 1,
+  highlight_limit = vim.g.neo_mittens_preview_highlight_mb or 0.5,
+  timeout = 150,
+  treesitter = true,
+  check_mime_type = false,
+}
+
+local function preview_maker(filepath, bufnr, opts)
+  opts = opts or {}
+  local previewers = require('telescope.previewers')
+  filepath = vim.fn.expand(filepath)
+  vim.loop.fs_open(filepath, "r", 438, function(err, fd)
+    if err or not fd then
+      return vim.schedule(function() previewers.buffer_previewer_maker(filepath, bufnr, opts) end)
+    end
+    vim.loop.fs_fstat(fd, function(_, stat)
+      vim.loop.fs_read(fd, 1024, 0, function(_, head)
+        vim.loop.fs_close(fd)
+        vim.schedule(function()
+          if not vim.api.nvim_buf_is_valid(bufnr) then return end
+          if head and head:find("\0", 1, true) then
+            vim.api.nvim_buf_set_lines(bufnr, 0, -1, false, { "binary file, no preview" })
+            return
+          end
+          if stat and stat.size > ts_preview_limit then
+            opts.preview = vim.tbl_extend("force", opts.preview or preview, { treesitter = false })
+          end
+          previewers.buffer_previewer_maker(filepath, bufnr, opts)
+        end)
+      end)
+    end)
+  end)
+end
+
+telescope.setup({
+  defaults = {
+    vimgrep_arguments = vimgrep_arguments,
+    preview = preview,
+    buffer_previewer_maker = preview_maker,
+  },
+  pickers = {
+    find_files = { find_command = find_command(false) },
+  },
+  extensions = {
+    -- compiled C sorter, way faster than the lua one on big trees
+    fzf = {
+      fuzzy = true,
+      override_generic_sorter = true,
+      override_file_sorter = true,
+      case_mode = "smart_case",
+    },
+  },
+})
+-- the native lib might not have been built (no make / cc), fall back quietly
+pcall(telescope.load_extension, 'fzf')
+
+-- live_grep that doesn't stack up rg processes while typing. The prompt is
+-- debounced, new_async_job kills the previous rg before spawning the next,
+-- short queries don't search at all, and once the cap is hit the job gets
+-- closed, which kills rg instead of letting it walk the rest of the tree.
+-- rg is spawned directly, a `sh -c 'rg | head'` would only get sh killed.
+local function live_grep(opts)
+  opts = opts or {}
+  local pickers = require('telescope.pickers')
+  local finders = require('telescope.finders')
+  local make_entry = require('telescope.make_entry')
+  local sorters = require('telescope.sorters')
+  local conf = require('telescope.config').values
+
+  local min_len = vim.g.neo_mittens_grep_min_len or 3
+  local max_results = vim.g.neo_mittens_grep_max_results or 2000
+  opts.cwd = opts.cwd or vim.loop.cwd()
+
+  local vimgrep_entry = make_entry.gen_from_vimgrep(opts)
+  local count = 0
+  local finder
+  finder = finders.new_async_job({
+    command_generator = function(prompt)
+      if not prompt or #prompt < min_len then return nil end
+      count = 0
+      local cmd = vim.deepcopy(vimgrep_arguments)
+      vim.list_extend(cmd, { "--line-buffered", "--max-columns", "300", "--", prompt })
+      return cmd
+    end,
+    entry_maker = function(line)
+      count = count + 1
+      if count > max_results then
+        if count == max_results + 1 then pcall(finder.close) end
+        return nil
+      end
+      return vimgrep_entry(line)
+    end,
+    cwd = opts.cwd,
+  })
+
+  pickers.new(opts, {
+    prompt_title = "Live Grep",
+    finder = finder,
+    previewer = conf.grep_previewer(opts),
+    sorter = sorters.highlighter_only(opts),
+    debounce = vim.g.neo_mittens_grep_debounce or 150,
+  }):find()
+end
+
+-- cached + frecency ranked, see files.lua
+vim.keymap.set('n', '<leader>ff', function()
+  require('neo-mittens.files').pick({ ignore = ignore, find_command = find_command(false) })
+end, {})
+vim.keymap.set('n', '<leader>ffh', function()
+  require('neo-mittens.files').pick({ hidden = true, ignore = ignore, find_command = find_command(true) })
+end, {})
+vim.keymap.set('n', '<leader>fg', function() live_grep() end, {})
 vim.keymap.set('n', '<leader>fb', function() builtin.buffers() end, {})
 vim.keymap.set('n', '<leader>fh', function() builtin.help_tags() end, {})
 vim.keymap.set('n', '<leader>fq', function() builtin.quickfix() end, {})
@@ -9,7 +155,7 @@ vim.keymap.set('n', '<leader>fqq', function() builtin.quickfixhistory() end, {})
 vim.keymap.set('n', '<leader>fj', function() builtin.jumplist() end, {})
 vim.keymap.set('n', '<leader>fm', function() builtin.marks() end, {})
 vim.keymap.set('n', '<leader>fr', function() builtin.registers() end, {})
-vim.keymap.set('n', '<leader>fo', function() builtin.lsp_outgoing_calls() end, {})
+vim.keymap.set('n', '<leader>fo', function() require('neo-mittens.lsp-cache').outgoing_calls() end, {})
 vim.keymap.set('n', '<leader>fd', function() builtin.lsp_definitions() end, {})
 vim.keymap.set('n', '<leader>fs', function() builtin.lsp_document_symbols() end, {})
-vim.keymap.set('n', '<leader>fws', function() builtin.lsp_dynamic_workspace_symbols() end, {})
+vim.keymap.set('n', '<leader>fws', function() require('neo-mittens.symbols').pick() end, {})
@@ -1,8 +1,49 @@
 local api = vim.api
 
--- TODO: look into potentially using au groups (auto command groups to group these for some reason ?)
+-- Terminal profile. Build / test output in :terminal runs to millions of
+-- lines, so scrollback is capped (vim.g.neo_mittens_term_scrollback, 10000)
+-- and everything that redraws per line is off: numbers, signs, cursorline,
+-- colorcolumn, indent guides (ibl excludes terminals) and the overview.
+--
+-- For the really heavy stuff `:TermLog make -j64` sends the output straight
+-- to a log file and only shows `tail -F` of it.
+--
+-- Autocmds live in an augroup so re-sourcing (<leader>s) doesn't stack them.
 -- https://stackoverflow.com/questions/63906439/how-to-disable-line-numbers-in-neovim-terminal
-api.nvim_command("autocmd TermOpen * startinsert")             -- starts in insert mode
-api.nvim_command("autocmd TermOpen * setlocal nonumber")       -- no numbers
-api.nvim_command("autocmd TermOpen * setlocal norelativenumber")       -- no numbers
-api.nvim_command("autocmd TermEnter * setlocal signcolumn=no") -- no sign column
+local group = api.nvim_create_augroup("NeoMittensTerm", { clear = true })
+
+api.nvim_create_autocmd("TermOpen", {
+  group = group,
+  callback = function(args)
+    vim.opt_local.scrollback = vim.g.neo_mittens_term_scrollback or 10000
+    vim.opt_local.number = false           -- no numbers
+    vim.opt_local.relativenumber = false   -- no numbers
+    vim.opt_local.cursorline = false
+    vim.opt_local.colorcolumn = ""
+    vim.b[args.buf].minimap_disable = true -- overview.lua skips these
+    vim.cmd("startinsert")                 -- starts in insert mode
+  end,
+})
+
+api.nvim_create_autocmd("TermEnter", {
+  group = group,
+  callback = function() vim.opt_local.signcolumn = "no" end, -- no sign column
+})
+
+-- :TermLog {cmd}, runs cmd with its output going to a log file and opens a
+-- terminal tailing that file
+api.nvim_create_user_command("TermLog", function(args)
+  local dir = vim.fn.stdpath("state") .. "/neo-mittens/term"
+  vim.fn.mkdir(dir, "p")
+  local log = ("%s/%s.log"):format(dir, os.date("%Y%m%d-%H%M%S"))
+
+  vim.fn.jobstart({ "sh", "-c", "(" .. args.args .. ") > " .. vim.fn.shellescape(log) .. " 2>&1" }, {
+    on_exit = function(_, code)
+      vim.notify(("TermLog: `%s` exited %d, log in %s"):format(args.args, code, log),
+        code == 0 and vim.log.levels.INFO or vim.log.levels.WARN)
+    end,
+  })
+
+  vim.cmd("botright split")
+  vim.cmd("terminal tail -n 1000 -F " .. vim.fn.fnameescape(log))
+end, { nargs = "+", complete = "shellcmd" })
@@ -1,19 +1,65 @@
 -- treesitter-config.lua
 
 local configs = require("nvim-treesitter.configs")
+local bigfile = require("neo-mittens.bigfile")
+local bootstrap = require("neo-mittens.ts-bootstrap")
+
+-- precompiled parsers, see ts-bootstrap.lua. nothing gets compiled here.
+local parser_dir = bootstrap.dir()
+vim.opt.rtp:prepend(parser_dir)
+
+-- Per language line budgets, past which the expensive parts switch off.
+-- Core's highlighter already only runs queries for the lines on screen, what
+-- hurts in big template headers is indentexpr walking the tree on every <CR>
+-- and, further up, reparsing on each edit. Override with e.g.
+--   vim.g.neo_mittens_ts_budgets = { cpp = { indent = 2000 } }
+local budgets = vim.tbl_deep_extend("force", {
+	c = { indent = 5000, highlight = 30000 },
+	cpp = { indent = 5000, highlight = 30000 },
+}, vim.g.neo_mittens_ts_budgets or {})
+
+local function over_budget(lang, buf, what)
+	local budget = budgets[lang] and budgets[lang][what]
+	return budget ~= nil and vim.api.nvim_buf_line_count(buf) > budget
+end
+
 configs.setup {
-	-- Add a language of your choice
-	ensure_installed = {
-		"c", "cpp", "python",
-		"lua", "vim", "vimdoc", "query",
-		"javascript", "html",},
+	-- Add a language of your choice in ts-bootstrap.lua, it does the installing
+	ensure_installed = {},
 	sync_install = false,
+	auto_install = false,
+	parser_install_dir = parser_dir,
 	-- ignore_install = { "" }, -- List of parsers to ignore installing
 	highlight = {
 		enable = true, -- false will disable the whole extension
 		-- disable = { "" }, -- list of language that will be disabled
+		disable = function(lang, buf) return bigfile.is_big(buf) or over_budget(lang, buf, "highlight") end,
 		additional_vim_regex_highlighting = false,
 
 	},
-	indent = { enable = true, disable = { "yaml" } },
+	indent = {
+		enable = true,
+		disable = function(lang, buf)
+			return lang == "yaml" or bigfile.is_big(buf) or over_budget(lang, buf, "indent")
+		end,
+	},
 }
+
+-- over the indent budget the c/cpp buffers go back to plain cindent, with
+-- smartindent from settings.lua still there underneath
+vim.api.nvim_create_autocmd("FileType", {
+	group = vim.api.nvim_create_augroup("NeoMittensTSBudget", { clear = true }),
+	pattern = { "c", "cpp" },
+	callback = function(args)
+		if over_budget(args.match, args.buf, "indent") then
+			vim.bo[args.buf].indentexpr = ""
+			vim.bo[args.buf].cindent = true
+		end
+	end,
+})
+
+local missing = bootstrap.missing()
+if #missing > 0 then
+	vim.notify("treesitter parsers missing (" .. table.concat(missing, ", ") .. "), run :NeoMittensTSBootstrap",
+		vim.log.levels.WARN)
+end
@@ -0,0 +1,188 @@
+-- ts-bootstrap.lua
+--
+-- Treesitter parsers get compiled once, ahead of time, never on startup.
+--
+-- Compiled parsers live in a cache dir keyed by the nvim-treesitter revision
+-- (plus os/arch), so a cache baked into an image or sitting on a shared
+-- disk is reused as is, and a treesitter update gets a fresh dir instead of
+-- stale .so files:
+--
+--   vim.g.neo_mittens_ts_parser_cache = "/shared/nvim/ts-parsers"
+--
+-- Fill it with :NeoMittensTSBootstrap, or headless (non-zero exit on
+-- failure) with
+--
+--   nvim --headless -c 'lua require("neo-mittens.ts-bootstrap").cli()'
+--
+-- lazy also runs it as the nvim-treesitter build step. Each parser is one
+-- clone + cc job at the grammar revision nvim-treesitter's lockfile pins, so
+-- a broken one is reported as soon as its compile exits.
+
+local util = require("neo-mittens.util")
+
+local M = {}
+
+M.parsers = {
+  "c", "cpp", "python",
+  "lua", "vim", "vimdoc", "query",
+  "javascript", "html",
+}
+
+local revision
+
+function M.revision()
+  if revision then return revision end
+  revision = "unknown"
+  local ok, config = pcall(require, "lazy.core.config")
+  local plugin = ok and config.plugins["nvim-treesitter"]
+  if plugin then
+    local git_ok, info = pcall(function() return require("lazy.manage.git").info(plugin.dir) end)
+    if git_ok and info and info.commit then revision = info.commit:sub(1, 12) end
+  end
+  return revision
+end
+
+function M.dir()
+  local root = vim.g.neo_mittens_ts_parser_cache or (vim.fn.stdpath("cache") .. "/ts-parsers")
+  return ("%s/%s-%s-%s"):format(root, M.revision(), jit.os, jit.arch):lower()
+end
+
+function M.missing()
+  local dir = M.dir()
+  local out = {}
+  for _, lang in ipairs(M.parsers) do
+    if not vim.loop.fs_stat(dir .. "/parser/" .. lang .. ".so") then
+      table.insert(out, lang)
+    end
+  end
+  return out
+end
+
+-- nvim-treesitter's lockfile.json, lang -> { revision }
+local function lockfile()
+  local ok, config = pcall(require, "lazy.core.config")
+  local plugin = ok and config.plugins["nvim-treesitter"]
+  local f = plugin and io.open(plugin.dir .. "/lockfile.json", "r")
+  if not f then return {} end
+  local decoded_ok, lock = pcall(vim.json.decode, f:read("*a"))
+  f:close()
+  return decoded_ok and lock or {}
+end
+
+-- Clones the grammar at the locked revision and builds parser/<lang>.so,
+-- the same compile nvim-treesitter does, but as one job we can see finish
+local compile_script = [[
+  exec 2>&1
+  set -e
+  url="$1" rev="$2" branch="$3" loc="$4" out="$5"; shift 5
+  tmp=$(mktemp -d); trap 'rm -rf "$tmp"' EXIT
+  git clone --quiet --filter=blob:none ${branch:+--branch "$branch"} "$url" "$tmp/src"
+  cd "$tmp/src"
+  if [ -n "$rev" ]; then git checkout --quiet "$rev"; fi
+  if [ -n "$loc" ]; then cd "$loc"; fi
+  cc=${CC:-cc}
+  case " $* " in *.cc\ *|*.cpp\ *) cc="${CXX:-c++}" ;; esac
+  $cc -o "$tmp/parser.so" -I./src -shared -Os -fPIC "$@"
+  mkdir -p "$(dirname "$out")"
+  mv "$tmp/parser.so" "$out"
+]]
+
+-- cb(err), err nil on success
+local function compile(lang, lock, dir, cb)
+  local parsers = require("nvim-treesitter.parsers").get_parser_configs()
+  local info = parsers[lang] and parsers[lang].install_info
+  if not info then return cb("no install info") end
+  local rev = lock[lang] and lock[lang].revision or ""
+  local cmd = {
+    "sh", "-c", compile_script, "sh",
+    info.url, rev, info.branch or "", info.location or "", dir .. "/parser/" .. lang .. ".so",
+  }
+  vim.list_extend(cmd, info.files)
+  util.job(cmd, {}, function(code, out)
+    if code ~= 0 then return cb(out[#out] or ("exit " .. code)) end
+    -- so :TSUpdate sees these as current
+    vim.fn.mkdir(dir .. "/parser-info", "p")
+    vim.fn.writefile({ rev }, dir .. "/parser-info/" .. lang .. ".revision")
+    cb(nil)
+  end)
+end
+
+-- Compiles whatever is missing, `jobs` parsers at a time, each as its own
+-- job so a failure is known the moment it happens.
+-- opts.jobs (default core count), opts.wait (default true), opts.timeout (ms
+-- overall, default 10 minutes), opts.on_done(ok, failed)
+-- Returns true, or false and the parsers that didn't make it. With wait =
+-- false it returns right away and only on_done gets the outcome.
+function M.bootstrap(opts)
+  opts = opts or {}
+  -- as the build step after a :Lazy update the revision moved under us
+  revision = nil
+  -- pulls in nvim-treesitter (parser configs) and points it at our cache
+  require("lazy").load({ plugins = { "nvim-treesitter" } })
+
+  -- treesitter-config set the dir of the revision this session started on
+  local configs = require("nvim-treesitter.configs")
+  if vim.fs.normalize(configs.get_parser_install_dir() or "") ~= vim.fs.normalize(M.dir() .. "/parser") then
+    configs.setup({ parser_install_dir = M.dir() })
+    vim.opt.rtp:prepend(M.dir())
+  end
+
+  local dir, lock = M.dir(), lockfile()
+  local queue = M.missing()
+  local limit = opts.jobs or vim.g.neo_mittens_install_jobs or util.cpu_count()
+  local running, failed, done = 0, {}, #queue == 0
+  local on_done = opts.on_done or function() end
+
+  local function pump()
+    while running < limit and #queue > 0 do
+      local lang = table.remove(queue, 1)
+      running = running + 1
+      compile(lang, lock, dir, function(err)
+        running = running - 1
+        if err then table.insert(failed, lang .. " (" .. err .. ")") end
+        if running == 0 and #queue == 0 then
+          done = true
+          on_done(#failed == 0, failed)
+        else
+          pump()
+        end
+      end)
+    end
+  end
+
+  if done then
+    on_done(true, failed)
+  else
+    pump()
+  end
+  if opts.wait == false then return true end
+
+  vim.wait(opts.timeout or 600000, function() return done end, 200)
+  if not done then table.insert(failed, "timed out, " .. (#queue + running) .. " left") end
+  return #failed == 0, failed
+end
+
+-- :NeoMittensTSBootstrap, compiles in the background and says when it's done
+function M.command()
+  vim.notify("treesitter parsers: compiling into " .. M.dir())
+  M.bootstrap({
+    wait = false,
+    on_done = function(ok, failed)
+      if ok then
+        vim.notify("treesitter parsers ready in " .. M.dir())
+      else
+        vim.notify("treesitter parsers failed: " .. table.concat(failed, ", "), vim.log.levels.ERROR)
+      end
+    end,
+  })
+end
+
+function M.cli()
+  local ok, failed = M.bootstrap()
+  if not ok then
+    io.stderr:write("treesitter parsers failed: " .. table.concat(failed, ", ") .. "\n")
+  end
+  vim.cmd(ok and "qall!" or "cquit 1")
+end
+
+return M
@@ -0,0 +1,58 @@
+-- util.lua
+--
+-- Small helpers shared by the neo-mittens modules.
+
+local M = {}
+
+function M.cpu_count()
+  if vim.loop.available_parallelism then
+    return vim.loop.available_parallelism()
+  end
+  return math.max(1, #(vim.loop.cpu_info() or {}))
+end
+
+-- first of `names` found on $PATH, or nil
+function M.executable(names)
+  for _, name in ipairs(names) do
+    if vim.fn.executable(name) == 1 then return name end
+  end
+end
+
+-- Runs `cmd` async, cb(code, stdout_lines). opts.cwd as for jobstart.
+-- Returns the job id (<= 0 when it couldn't start, cb still gets called).
+function M.job(cmd, opts, cb)
+  local out = {}
+  local id = vim.fn.jobstart(cmd, {
+    cwd = opts and opts.cwd,
+    stdout_buffered = true,
+    on_stdout = function(_, data) out = data end,
+    on_exit = function(_, code)
+      if out[#out] == "" then table.remove(out) end
+      cb(code, out)
+    end,
+  })
+  if id <= 0 then vim.schedule(function() cb(-1, {}) end) end
+  return id
+end
+
+-- wrapper -> what it wrapped, kept across :NeoMittensReload (which drops
+-- this module too) so a reloaded module doesn't wrap its own old wrapper
+local wrapped = rawget(_G, "neo_mittens_wrapped") or setmetatable({}, { __mode = "k" })
+rawset(_G, "neo_mittens_wrapped", wrapped)
+
+-- tbl[key] = make(original). Wrapping again (after a reload) starts from the
+-- original, not from the previous wrapper. Returns the wrapper.
+function M.wrap(tbl, key, make)
+  local original = wrapped[tbl[key]] or tbl[key]
+  local wrapper = make(original)
+  wrapped[wrapper] = original
+  tbl[key] = wrapper
+  return wrapper
+end
+
+-- vim.lsp.get_clients only showed up in 0.10
+function M.lsp_clients(filter)
+  return (vim.lsp.get_clients or vim.lsp.get_active_clients)(filter)
+end
+
+return M